@@ -1,358 +1,3454 @@
 #include <iostream>
 #include <string>
-#include <queue>
 #include <vector>
 #include <fstream>
-#include <chrono>
 #include <random>
 #include <ctime>
 #include <iomanip>
 #include <sstream>
 #include <limits>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <map>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <iterator>
+#include <new>
+#include <cstring>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#endif
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
 
 using namespace std;
 
+// ================================= Instrument Class =================================
+
+// Prices are integer multiples of the instrument's tick size
+using Price = int32_t;
+
+const Price NO_PRICE = 0; // Valid prices are at least one tick
+
+class Instrument {
+public:
+    string symbol;
+    int priceDecimals;      // Decimal places a price is quoted with (2 => cents)
+    int tickIncrement;      // Tick size in units of 10^-priceDecimals (1 with 2 decimals => $0.01)
+    Price maxPrice;         // Price band: highest accepted price, in ticks
+    
+    Instrument(const string& instrumentSymbol, int decimals, int increment, Price maxPriceTicks)
+        : symbol(instrumentSymbol), priceDecimals(decimals), tickIncrement(increment), maxPrice(maxPriceTicks) {}
+    
+    double tickSize() const {
+        return tickIncrement / pow(10.0, priceDecimals);
+    }
+    
+    // Convert a quoted price to ticks; fails if it is not a whole number of ticks or is too
+    // large to be held as a Price (rather than wrapping round onto some valid price)
+    bool toTicks(double price, Price& ticks) const {
+        double units = price * pow(10.0, priceDecimals);
+        if (!(fabs(units) < 9e18)) { // Also rejects NaN; llround is undefined past long long
+            return false;
+        }
+        long long rounded = llround(units);
+        if (fabs(units - rounded) > 1e-6 || rounded % tickIncrement != 0) {
+            return false;
+        }
+        long long wholeTicks = rounded / tickIncrement;
+        if (wholeTicks < numeric_limits<Price>::min() || wholeTicks > numeric_limits<Price>::max()) {
+            return false;
+        }
+        ticks = static_cast<Price>(wholeTicks);
+        return true;
+    }
+    
+    bool inPriceBand(Price ticks) const {
+        return ticks > NO_PRICE && ticks <= maxPrice;
+    }
+    
+    // Exact decimal rendering of a tick price, e.g. 9550 ticks of $0.01 => "95.50"
+    string formatPrice(Price ticks) const {
+        long long units = static_cast<long long>(ticks) * tickIncrement;
+        string result = to_string(units);
+        if (priceDecimals == 0) {
+            return result;
+        }
+        if (result.size() <= static_cast<size_t>(priceDecimals)) {
+            result.insert(0, priceDecimals + 1 - result.size(), '0');
+        }
+        result.insert(result.size() - priceDecimals, ".");
+        return result;
+    }
+    
+    // Default simulated instrument: cent ticks with a $0.01 - $1000.00 price band
+    static Instrument defaultInstrument() {
+        return Instrument("SIM", 2, 1, 100000);
+    }
+};
+
+// ================================= SymbolTable Class =================================
+
+// Dense instrument ID: orders carry it, and books are found by indexing with it
+using SymbolId = uint16_t;
+
+const SymbolId NO_SYMBOL = numeric_limits<SymbolId>::max();
+
+// Registry of tradable instruments. Symbols are interned into dense IDs once, when the
+// instrument list is loaded; after that everything is addressed by ID, so routing an order
+// is an array index rather than a string lookup.
+class SymbolTable {
+private:
+    vector<Instrument> instruments;      // Indexed by SymbolId
+    unordered_map<string, SymbolId> ids; // Load-time and user-input lookups only
+
+public:
+    // Returns the symbol's ID, registering it if new; NO_SYMBOL once every ID is taken
+    SymbolId intern(const Instrument& instrument) {
+        auto it = ids.find(instrument.symbol);
+        if (it != ids.end()) {
+            return it->second;
+        }
+        if (instruments.size() >= NO_SYMBOL) {
+            return NO_SYMBOL;
+        }
+        SymbolId id = static_cast<SymbolId>(instruments.size());
+        instruments.push_back(instrument);
+        ids.emplace(instrument.symbol, id);
+        return id;
+    }
+    
+    SymbolId find(const string& symbol) const {
+        auto it = ids.find(symbol);
+        return it == ids.end() ? NO_SYMBOL : it->second;
+    }
+    
+    bool contains(SymbolId id) const { return id < instruments.size(); }
+    const Instrument& operator[](SymbolId id) const { return instruments[id]; }
+    size_t size() const { return instruments.size(); }
+};
+
 // ================================= Order Class =================================
 
-class Order {
+enum class Side : uint8_t { Buy, Sell };
+
+using Quantity = uint32_t;
+
+inline const char* sideToString(Side side) {
+    return side == Side::Buy ? "buy" : "sell";
+}
+
+enum class OrderType : uint8_t {
+    Limit, // Trades at its price or better; any remainder rests
+    Market // No price: trades against whatever the opposite side holds, never rests
+};
+
+// How long an order's unfilled remainder may stay in the book
+enum class TimeInForce : uint8_t {
+    GTC, // Good till cancelled: the remainder rests
+    IOC, // Immediate or cancel: fill what crosses now, drop the rest
+    FOK, // Fill or kill: fill completely right now or not at all
+    DAY, // The remainder rests until the end of the trading day
+    GTD  // Good till date: the remainder rests until its expiry time
+};
+
+inline const char* timeInForceToString(TimeInForce timeInForce) {
+    switch (timeInForce) {
+        case TimeInForce::IOC: return "IOC";
+        case TimeInForce::FOK: return "FOK";
+        case TimeInForce::DAY: return "DAY";
+        case TimeInForce::GTD: return "GTD";
+        default: return "GTC";
+    }
+}
+
+// Fixed-layout, trivially copyable order record: two fit in a cache line, so books,
+// queues and journals can copy it with memcpy or map it directly
+class alignas(32) Order {
 public:
+    uint64_t timestamp;     // Engine sequence number assigned on acceptance; lower = earlier
     int orderID;
-    string type;
-    double price;
-    int quantity;
-    long timestamp;
+    Price price;            // In ticks
+    Quantity quantity;
+    Side side;
+    OrderType type;
+    SymbolId symbol;        // Instrument the order trades, see SymbolTable
+    TimeInForce timeInForce;
+    uint16_t displayQuantity; // Iceberg peak: the most shown at once; 0 = show the whole order
+    Quantity reserveQuantity; // Iceberg: hidden quantity still to be shown, slice by slice
+    
+    Order() = default;
+    
+    Order(int id, Side orderSide, Price orderPrice, Quantity orderQuantity, uint64_t orderTimestamp = 0,
+          SymbolId orderSymbol = 0)
+        : timestamp(orderTimestamp), orderID(id), price(orderPrice), quantity(orderQuantity), side(orderSide),
+          type(OrderType::Limit), symbol(orderSymbol), timeInForce(TimeInForce::GTC), displayQuantity(0),
+          reserveQuantity(0) {}
+    
+    // A market order carries no price (NO_PRICE)
+    static Order market(int id, Side orderSide, Quantity orderQuantity, SymbolId orderSymbol = 0) {
+        Order order(id, orderSide, NO_PRICE, orderQuantity, 0, orderSymbol);
+        order.type = OrderType::Market;
+        return order;
+    }
+    
+    // An iceberg trades its full quantity on arrival but, once resting, shows only peak
+    // at a time; the rest is held in reserve and shown as each slice fills
+    static Order iceberg(int id, Side orderSide, Price orderPrice, Quantity orderQuantity, uint16_t peak,
+                         SymbolId orderSymbol = 0) {
+        Order order(id, orderSide, orderPrice, orderQuantity, 0, orderSymbol);
+        order.displayQuantity = peak;
+        return order;
+    }
+    
+    bool isIceberg() const { return displayQuantity > 0; }
+    
+    void display(const Instrument& instrument) const {
+        cout << "Order ID: " << orderID << ", Symbol: " << instrument.symbol << ", Type: " << sideToString(side) 
+             << ", Price: " << (type == OrderType::Market ? "MARKET" : "$" + instrument.formatPrice(price))
+             << ", Quantity: " << quantity;
+        if (isIceberg()) {
+            cout << ", Iceberg peak: " << displayQuantity;
+        }
+        if (timeInForce != TimeInForce::GTC) {
+            cout << ", TIF: " << timeInForceToString(timeInForce);
+        }
+        cout << ", Timestamp: " << timestamp << endl;
+    }
+};
+
+static_assert(sizeof(Order) == 32, "Order must stay a 32-byte record");
+static_assert(is_trivially_copyable_v<Order>, "Order must be trivially copyable");
+
+// ================================= SideTraits =================================
+
+// Compile-time description of an incoming order's side: the book it trades against
+// and when its limit price crosses a resting price
+template <Side S>
+struct SideTraits;
+
+template <>
+struct SideTraits<Side::Buy> {
+    static constexpr Side opposite = Side::Sell;
+    static constexpr bool crosses(Price limit, Price resting) { return limit >= resting; }
+};
+
+template <>
+struct SideTraits<Side::Sell> {
+    static constexpr Side opposite = Side::Buy;
+    static constexpr bool crosses(Price limit, Price resting) { return limit <= resting; }
+};
+
+// ================================= Utils Class =================================
+
+class Utils {
+public:
+    static Order generateRandomOrder(int orderID, const SymbolTable& symbols) {
+        static random_device rd;
+        static mt19937 gen(rd());
+        static uniform_int_distribution<> typeDist(0, 1);
+        static uniform_int_distribution<> quantityDist(10, 500);
+        
+        uniform_int_distribution<size_t> symbolDist(0, symbols.size() - 1);
+        SymbolId symbol = static_cast<SymbolId>(symbols.size() > 1 ? symbolDist(gen) : 0);
+        const Instrument& instrument = symbols[symbol];
+        
+        // Prices are drawn directly in ticks between $50 and $150
+        Price lowTicks = NO_PRICE, highTicks = NO_PRICE;
+        instrument.toTicks(50.0, lowTicks);
+        instrument.toTicks(150.0, highTicks);
+        uniform_int_distribution<Price> priceDist(lowTicks, highTicks);
+        
+        Side side = (typeDist(gen) == 0) ? Side::Buy : Side::Sell;
+        Price price = priceDist(gen);
+        Quantity quantity = quantityDist(gen);
+        
+        return Order(orderID, side, price, quantity, 0, symbol);
+    }
+    
+    // Human-readable byte count, e.g. 1536 => "1.5 KB"
+    static string formatBytes(size_t bytes) {
+        const char* units[] = {"B", "KB", "MB", "GB", "TB"};
+        double value = static_cast<double>(bytes);
+        size_t unit = 0;
+        while (value >= 1024.0 && unit < 4) {
+            value /= 1024.0;
+            unit++;
+        }
+        ostringstream out;
+        out << fixed << setprecision(unit == 0 ? 0 : 1) << value << " " << units[unit];
+        return out.str();
+    }
+    
+    // Parse a count such as "250000", "500K" or "10M"
+    static bool parseCount(const string& text, size_t& value) {
+        size_t digits = 0;
+        unsigned long long number = 0;
+        try {
+            number = stoull(text, &digits);
+        } catch (const exception&) {
+            return false;
+        }
+        string suffix = text.substr(digits);
+        if (suffix == "K" || suffix == "k") {
+            number *= 1000ULL;
+        } else if (suffix == "M" || suffix == "m") {
+            number *= 1000000ULL;
+        } else if (suffix == "G" || suffix == "g") {
+            number *= 1000000000ULL;
+        } else if (!suffix.empty()) {
+            return false;
+        }
+        value = static_cast<size_t>(number);
+        return value > 0;
+    }
+};
+
+// ================================= TradeLogger Class =================================
+
+// One execution between an incoming and a resting order, at the resting order's price
+struct Trade {
+    int buyOrderID;
+    int sellOrderID;
+    Price price;
+    Quantity quantity;
+};
+
+class TradeLogger {
+private:
+    ofstream logFile;
+    bool echoToConsole; // Off when many engines run at once and the console would interleave
+    string batch;       // Reused buffer for one logTrades call
+    
+public:
+    TradeLogger(const string& filename = "trades.log", bool echo = true) : echoToConsole(echo) {
+        logFile.open(filename, ios::app);
+        if (logFile.is_open()) {
+            logFile << "\n========== Trading Session Started at " 
+                    << getCurrentTimeString() << " ==========\n";
+        }
+    }
+    
+    ~TradeLogger() {
+        if (logFile.is_open()) {
+            logFile << "========== Trading Session Ended at " 
+                    << getCurrentTimeString() << " ==========\n\n";
+            logFile.close();
+        }
+    }
+    
+    // Record every fill of one incoming order: the lines are formatted into one buffer and
+    // written (and flushed) once, so a sweep through many orders costs one write, not one each
+    void logTrades(const Instrument& instrument, const vector<Trade>& trades) {
+        string timestamp = getCurrentTimeString();
+        batch.clear();
+        for (const Trade& trade : trades) {
+            batch += "Trade executed: " + instrument.symbol + " BuyOrderID " + to_string(trade.buyOrderID) +
+                     " SellOrderID " + to_string(trade.sellOrderID) +
+                     " at price $" + instrument.formatPrice(trade.price) +
+                     " for quantity " + to_string(trade.quantity) + "\n";
+        }
+        
+        // Print to console
+        if (echoToConsole) {
+            cout << batch << flush;
+        }
+        
+        // Log to file, each line stamped with the batch's time
+        if (logFile.is_open()) {
+            size_t lineStart = 0;
+            for (size_t lineEnd = batch.find('\n'); lineEnd != string::npos; lineEnd = batch.find('\n', lineStart)) {
+                logFile << timestamp << " - ";
+                logFile.write(batch.data() + lineStart, lineEnd + 1 - lineStart);
+                lineStart = lineEnd + 1;
+            }
+            logFile.flush();
+        }
+    }
+    
+private:
+    string getCurrentTimeString() {
+        auto now = time(nullptr);
+        struct tm tm;
+#ifdef _WIN32
+        localtime_s(&tm, &now);
+#else
+        localtime_r(&now, &tm); // Engines on several threads log at once
+#endif
+        ostringstream oss;
+        oss << put_time(&tm, "%Y-%m-%d %H:%M:%S");
+        return oss.str();
+    }
+};
+
+// ================================= Memory Stats =================================
+
+// Occupancy and footprint of one container. Counts are in elements, sizes in bytes.
+// Fixed containers never allocate after startup; growable ones reallocate once used
+// passes capacity.
+struct ContainerStats {
+    size_t capacity = 0;      // Elements held without allocating
+    size_t used = 0;
+    size_t highWater = 0;     // Most elements held at once since startup
+    size_t bytesReserved = 0;
+    size_t bytesUsed = 0;
+    bool growable = false;
+};
+
+// One side of a book: ladder levels in the dense array or ring, levels parked in the
+// hybrid overflow map, and the orders resting on that side
+struct SideStats {
+    ContainerStats levels;
+    ContainerStats overflowLevels;
+    size_t orders = 0;
+    size_t ordersHighWater = 0;
+};
+
+struct BookStats {
+    string symbol;
+    SideStats bids;
+    SideStats asks;
+    
+    size_t bytesReserved() const {
+        return bids.levels.bytesReserved + bids.overflowLevels.bytesReserved +
+               asks.levels.bytesReserved + asks.overflowLevels.bytesReserved;
+    }
+};
+
+struct EngineStats {
+    size_t arenaBytesReserved = 0;
+    size_t arenaBytesUsed = 0;
+    string arenaBacking;
+    ContainerStats orderPool;
+    ContainerStats orderIndex;
+    ContainerStats expiryTimers; // GTD timer nodes, one per pool slot
+    ContainerStats tradeBuffer;  // Fills of one incoming order, reused across orders
+    size_t symbols = 0;
+    vector<BookStats> books;     // Books that exist, i.e. symbols that have had an order
+    size_t sideCap = 0;          // Resting orders allowed per side, 0 for no cap
+    uint64_t ordersEvicted = 0;  // Orders pushed out by the side cap
+    uint64_t ordersArchived = 0; // ... of which were written to the archive
+    size_t stopOrders = 0;       // Stop orders waiting for their stop price to trade
+    uint64_t ordersExpired = 0;  // GTD orders timed out plus DAY orders dropped at end of day
+    uint64_t capacityRejects = 0; // Unfilled remainders cancelled because the order pool was full
+    
+    // Sum over all containers, wherever they live (arena or heap)
+    size_t totalBytesReserved() const {
+        size_t total = orderPool.bytesReserved + orderIndex.bytesReserved + expiryTimers.bytesReserved +
+                       tradeBuffer.bytesReserved;
+        for (const BookStats& book : books) {
+            total += book.bytesReserved();
+        }
+        return total;
+    }
+};
+
+// ================================= Arena Class =================================
+
+// One contiguous block for all of the engine's fixed-size storage (order pool, order index,
+// price ladders). It is mapped once at startup, on 2 MB huge pages when the system has them,
+// and every page is faulted in before the first order arrives, so the hot path neither takes
+// page faults nor walks page tables for 4 KB pages. Allocation is a pointer bump; nothing is
+// returned to the arena until the engine shuts down. Requests that no longer fit fall back
+// to the global allocator so an undersized arena costs speed, not correctness.
+class Arena {
+public:
+    enum class Backing : uint8_t {
+        HugePages,            // Explicit MAP_HUGETLB pages from the reserved pool
+        TransparentHugePages, // Normal mapping with the kernel asked to back it with huge pages
+        NormalPages,          // Huge pages unavailable
+        None                  // Zero-sized arena: everything comes from the global allocator
+    };
+    
+    static constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+    static constexpr size_t BLOCK_ALIGNMENT = 64; // Keep every array cache-line aligned
+    
+    explicit Arena(size_t bytes) {
+        if (bytes == 0) {
+            return;
+        }
+        size_t size = roundUp(bytes, HUGE_PAGE_SIZE);
+#if defined(__unix__) || defined(__APPLE__)
+#ifdef MAP_HUGETLB
+        void* hugeBlock = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                               MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+        if (hugeBlock != MAP_FAILED) {
+            adopt(static_cast<char*>(hugeBlock), size, size, Backing::HugePages);
+            return;
+        }
+#endif
+        // Over-map by one huge page so the usable range can start on a huge-page boundary
+        size_t mappedSize = size + HUGE_PAGE_SIZE;
+        void* block = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (block == MAP_FAILED) {
+            return;
+        }
+        char* start = reinterpret_cast<char*>(roundUp(reinterpret_cast<uintptr_t>(block), HUGE_PAGE_SIZE));
+        Backing backing = Backing::NormalPages;
+#ifdef MADV_HUGEPAGE
+        if (madvise(start, size, MADV_HUGEPAGE) == 0) {
+            backing = Backing::TransparentHugePages;
+        }
+#endif
+        adopt(static_cast<char*>(block), mappedSize, 0, backing);
+        base = start;
+        capacity = size;
+        
+        // Touch one byte per small page now rather than on the first order that lands there
+        for (size_t offset = 0; offset < size; offset += 4096) {
+            static_cast<volatile char*>(base)[offset] = 0;
+        }
+#else
+        base = static_cast<char*>(::operator new(size, align_val_t(HUGE_PAGE_SIZE)));
+        capacity = size;
+        backing = Backing::NormalPages;
+        memset(base, 0, size);
+#endif
+    }
+    
+    ~Arena() {
+        if (mapping == nullptr && base == nullptr) {
+            return;
+        }
+#if defined(__unix__) || defined(__APPLE__)
+        munmap(mapping, mappedBytes);
+#else
+        ::operator delete(base, align_val_t(HUGE_PAGE_SIZE));
+#endif
+    }
+    
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+    
+    // Returns nullptr when the request does not fit in what is left
+    void* allocate(size_t bytes, size_t alignment) {
+        size_t offset = roundUp(used, max(alignment, BLOCK_ALIGNMENT));
+        if (base == nullptr || offset + bytes > capacity) {
+            return nullptr;
+        }
+        used = offset + bytes;
+        return base + offset;
+    }
+    
+    bool owns(const void* pointer) const {
+        const char* p = static_cast<const char*>(pointer);
+        return base != nullptr && p >= base && p < base + capacity;
+    }
+    
+    size_t bytesReserved() const { return capacity; }
+    size_t bytesUsed() const { return used; }
+    
+    string backingName() const {
+        switch (backing) {
+            case Backing::HugePages: return "huge pages";
+            case Backing::TransparentHugePages: return "transparent huge pages";
+            case Backing::NormalPages: return "normal pages";
+            default: return "heap";
+        }
+    }
+    
+    // Bytes a block of the given size takes out of the arena, padding included
+    static size_t footprint(size_t bytes) { return roundUp(bytes, BLOCK_ALIGNMENT); }
+
+private:
+    char* base = nullptr;     // Start of the usable, huge-page aligned range
+    size_t capacity = 0;
+    size_t used = 0;
+    Backing backing = Backing::None;
+    void* mapping = nullptr;  // Whole mapping as returned by mmap, for munmap
+    size_t mappedBytes = 0;
+    
+    static size_t roundUp(size_t value, size_t alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+    
+    void adopt(char* block, size_t blockBytes, size_t usableBytes, Backing blockBacking) {
+        mapping = block;
+        mappedBytes = blockBytes;
+        base = block;
+        capacity = usableBytes;
+        backing = blockBacking;
+    }
+};
+
+// Standard allocator over an Arena, so containers sized once at startup can live in it
+template <typename T>
+struct ArenaAllocator {
+    using value_type = T;
+    
+    Arena* arena;
+    
+    explicit ArenaAllocator(Arena& source) : arena(&source) {}
+    
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+    
+    T* allocate(size_t count) {
+        void* block = arena->allocate(count * sizeof(T), alignof(T));
+        if (block == nullptr) {
+            block = ::operator new(count * sizeof(T), align_val_t(alignof(T)));
+        }
+        return static_cast<T*>(block);
+    }
     
-    Order(int id, const string& orderType, double orderPrice, int orderQuantity, long orderTimestamp)
-        : orderID(id), type(orderType), price(orderPrice), quantity(orderQuantity), timestamp(orderTimestamp) {}
+    void deallocate(T* block, size_t) {
+        if (!arena->owns(block)) {
+            ::operator delete(block, align_val_t(alignof(T)));
+        }
+    }
+    
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const { return arena == other.arena; }
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.arena; }
+};
+
+template <typename T>
+using ArenaVector = vector<T, ArenaAllocator<T>>;
+
+// ================================= OrderPool Class =================================
+
+using OrderHandle = uint32_t;
+
+const OrderHandle NULL_HANDLE = numeric_limits<OrderHandle>::max();
+
+// Queue links of a pooled order: neighbours within its price level, or the free list
+// (a free slot's prev points at itself, marking it free)
+struct OrderLinks {
+    OrderHandle prev;
+    OrderHandle next;
+};
+
+// Fixed-capacity storage for resting orders. All slots are allocated up front and
+// recycled through a free list, so the hot path never calls the global allocator.
+class OrderPool {
+private:
+    ArenaVector<Order> orders;
+    ArenaVector<OrderLinks> links;
+    OrderHandle freeHead = NULL_HANDLE;
+    size_t used = 0;
+    size_t highWater = 0;
+
+public:
+    OrderPool(size_t capacity, Arena& arena)
+        : orders(capacity, Order(), ArenaAllocator<Order>(arena)),
+          links(capacity, OrderLinks(), ArenaAllocator<OrderLinks>(arena)) {
+        clear();
+    }
+    
+    // Returns NULL_HANDLE when the pool is exhausted
+    OrderHandle allocate(const Order& order) {
+        OrderHandle handle = freeHead;
+        if (handle != NULL_HANDLE) {
+            freeHead = links[handle].next;
+            orders[handle] = order;
+            links[handle] = OrderLinks{NULL_HANDLE, NULL_HANDLE};
+            highWater = max(highWater, ++used);
+        }
+        return handle;
+    }
+    
+    void release(OrderHandle handle) {
+        links[handle] = OrderLinks{handle, freeHead};
+        freeHead = handle;
+        used--;
+    }
+    
+    // Free every slot at once, in one sequential pass
+    void clear() {
+        freeHead = NULL_HANDLE;
+        for (size_t i = capacity(); i-- > 0;) {
+            OrderHandle handle = static_cast<OrderHandle>(i);
+            links[i] = OrderLinks{handle, freeHead};
+            freeHead = handle;
+        }
+        used = 0;
+    }
+    
+    // Free every in-use slot whose order release(handle, order) returns true, rebuilding the
+    // free list in one sequential pass over the pool. Returns the number of slots freed.
+    template <typename Release>
+    size_t releaseIf(Release release) {
+        size_t freed = 0;
+        freeHead = NULL_HANDLE;
+        for (size_t i = capacity(); i-- > 0;) {
+            OrderHandle handle = static_cast<OrderHandle>(i);
+            bool isFree = links[i].prev == handle;
+            if (isFree || release(handle, orders[i])) {
+                links[i] = OrderLinks{handle, freeHead};
+                freeHead = handle;
+                freed += isFree ? 0 : 1;
+            }
+        }
+        used -= freed;
+        return freed;
+    }
+    
+    Order& operator[](OrderHandle handle) { return orders[handle]; }
+    const Order& operator[](OrderHandle handle) const { return orders[handle]; }
+    OrderLinks& linksOf(OrderHandle handle) { return links[handle]; }
+    const OrderLinks& linksOf(OrderHandle handle) const { return links[handle]; }
+    
+    bool isFull() const { return freeHead == NULL_HANDLE; }
+    size_t size() const { return used; }
+    size_t capacity() const { return orders.size(); }
+    
+    ContainerStats stats() const {
+        size_t slotBytes = sizeof(Order) + sizeof(OrderLinks);
+        return ContainerStats{capacity(), used, highWater, capacity() * slotBytes, used * slotBytes, false};
+    }
+    
+    static size_t arenaBytes(size_t capacity) {
+        return Arena::footprint(capacity * sizeof(Order)) + Arena::footprint(capacity * sizeof(OrderLinks));
+    }
+};
+
+// ================================= OrderIndex Class =================================
+
+// Open-addressing orderID -> handle map, sized once for the pool's capacity so that
+// inserts and erases never allocate. Linear probing with backward-shift deletion.
+class OrderIndex {
+private:
+    struct Slot {
+        int orderID;
+        OrderHandle handle; // NULL_HANDLE marks an empty slot
+    };
+    
+    ArenaVector<Slot> slots;
+    size_t mask;
+    size_t count = 0;
+    size_t highWater = 0;
+
+    static size_t tableSize(size_t maxEntries) {
+        size_t size = 1;
+        while (size < maxEntries * 2) { // Keep the load factor at or below one half
+            size <<= 1;
+        }
+        return size;
+    }
+    
+    size_t home(int orderID) const {
+        // Fibonacci hashing spreads sequential IDs across the table
+        return static_cast<size_t>((static_cast<uint64_t>(static_cast<uint32_t>(orderID)) *
+                                    0x9E3779B97F4A7C15ULL) >> 32) & mask;
+    }
+
+public:
+    OrderIndex(size_t maxEntries, Arena& arena)
+        : slots(tableSize(maxEntries), Slot{0, NULL_HANDLE}, ArenaAllocator<Slot>(arena)),
+          mask(slots.size() - 1) {}
+    
+    static size_t arenaBytes(size_t maxEntries) {
+        return Arena::footprint(tableSize(maxEntries) * sizeof(Slot));
+    }
+    
+    OrderHandle find(int orderID) const {
+        for (size_t i = home(orderID);; i = (i + 1) & mask) {
+            if (slots[i].handle == NULL_HANDLE) {
+                return NULL_HANDLE;
+            }
+            if (slots[i].orderID == orderID) {
+                return slots[i].handle;
+            }
+        }
+    }
+    
+    void insert(int orderID, OrderHandle handle) {
+        size_t i = home(orderID);
+        while (slots[i].handle != NULL_HANDLE && slots[i].orderID != orderID) {
+            i = (i + 1) & mask;
+        }
+        if (slots[i].handle == NULL_HANDLE) {
+            highWater = max(highWater, ++count);
+        }
+        slots[i] = Slot{orderID, handle};
+    }
+    
+    // Drop every entry in one sequential pass over the table
+    void clear() {
+        fill(slots.begin(), slots.end(), Slot{0, NULL_HANDLE});
+        count = 0;
+    }
+    
+    // Capacity is the entry limit that keeps the load factor at one half
+    ContainerStats stats() const {
+        return ContainerStats{slots.size() / 2, count, highWater, slots.size() * sizeof(Slot),
+                              count * sizeof(Slot), false};
+    }
+    
+    void erase(int orderID) {
+        size_t i = home(orderID);
+        while (slots[i].orderID != orderID || slots[i].handle == NULL_HANDLE) {
+            if (slots[i].handle == NULL_HANDLE) {
+                return;
+            }
+            i = (i + 1) & mask;
+        }
+        // Shift later entries of the probe run back so no tombstones are needed
+        for (size_t j = (i + 1) & mask; slots[j].handle != NULL_HANDLE; j = (j + 1) & mask) {
+            size_t target = home(slots[j].orderID);
+            if (((j - target) & mask) >= ((j - i) & mask)) {
+                slots[i] = slots[j];
+                i = j;
+            }
+        }
+        slots[i].handle = NULL_HANDLE;
+        count--;
+    }
+};
+
+// ================================= TimerWheel Class =================================
+
+using EngineTime = uint64_t; // Engine clock in milliseconds, advanced by the caller
+const EngineTime NO_EXPIRY = numeric_limits<EngineTime>::max();
+
+// Hierarchical timing wheel of good-till-date expiries, with one intrusive node per pool
+// slot so that scheduling and cancelling are O(1) list splices that never allocate. Level l
+// has 256 slots of 256^l ms; a timer sits in the lowest level whose current rotation holds
+// its expiry and moves down a level each time its slot comes round, so it is touched at
+// most once per level before it fires. Per-level occupancy masks let advance() jump
+// straight to the next slot holding timers instead of ticking through empty time.
+class TimerWheel {
+private:
+    static constexpr size_t SLOT_BITS = 8;
+    static constexpr size_t SLOTS = size_t(1) << SLOT_BITS;
+    static constexpr size_t LEVELS = 8; // Together the levels span the whole 64-bit clock
+    
+    struct Node {
+        EngineTime expiry;
+        OrderHandle prev; // NULL_HANDLE while not scheduled
+        OrderHandle next;
+    };
+    
+    // Nodes [0, capacity) belong to pool slots; the rest are circular list heads, one per wheel slot
+    ArenaVector<Node> nodes;
+    OrderHandle firstHead;
+    uint64_t occupied[LEVELS][SLOTS / 64] = {};
+    EngineTime now = 0;
+    size_t scheduled = 0;
+    size_t highWater = 0;
+    
+    OrderHandle headOf(size_t level, size_t slot) const {
+        return firstHead + static_cast<OrderHandle>(level * SLOTS + slot);
+    }
+    
+    static size_t slotOf(EngineTime time, size_t level) {
+        return static_cast<size_t>(time >> (SLOT_BITS * level)) & (SLOTS - 1);
+    }
+    
+    // Link a node into the slot its expiry falls in, as seen from now (expiry >= now)
+    void place(OrderHandle handle) {
+        Node& node = nodes[handle];
+        size_t level = 0;
+        while (level + 1 < LEVELS && (node.expiry >> (SLOT_BITS * (level + 1))) != (now >> (SLOT_BITS * (level + 1)))) {
+            level++;
+        }
+        size_t slot = slotOf(node.expiry, level);
+        OrderHandle head = headOf(level, slot);
+        node.prev = nodes[head].prev;
+        node.next = head;
+        nodes[node.prev].next = handle;
+        nodes[head].prev = handle;
+        occupied[level][slot >> 6] |= 1ULL << (slot & 63);
+    }
+    
+    // Unlink a slot's whole list at once; returns its first node (the list stays chained)
+    OrderHandle detach(size_t level, size_t slot) {
+        OrderHandle head = headOf(level, slot);
+        OrderHandle first = nodes[head].next;
+        nodes[nodes[head].prev].next = NULL_HANDLE;
+        nodes[head].prev = nodes[head].next = head;
+        occupied[level][slot >> 6] &= ~(1ULL << (slot & 63));
+        return first == head ? NULL_HANDLE : first;
+    }
+    
+    // First occupied slot of a level after the given one, or SLOTS
+    size_t nextOccupied(size_t level, size_t after) const {
+        for (size_t slot = after + 1; slot < SLOTS; slot = (slot | 63) + 1) {
+            uint64_t bits = occupied[level][slot >> 6] >> (slot & 63);
+            if (bits != 0) {
+                return slot + __builtin_ctzll(bits);
+            }
+        }
+        return SLOTS;
+    }
+    
+    // Start of the next slot, at any level, that holds timers; NO_EXPIRY if none
+    EngineTime nextEvent() const {
+        EngineTime next = NO_EXPIRY;
+        for (size_t level = 0; level < LEVELS; level++) {
+            size_t slot = nextOccupied(level, slotOf(now, level));
+            if (slot < SLOTS) {
+                size_t shift = SLOT_BITS * (level + 1);
+                EngineTime rotation = shift < 64 ? (now >> shift) << shift : 0;
+                next = min(next, rotation + (static_cast<EngineTime>(slot) << (SLOT_BITS * level)));
+            }
+        }
+        return next;
+    }
+
+public:
+    TimerWheel(size_t capacity, Arena& arena)
+        : nodes(capacity + LEVELS * SLOTS, Node{NO_EXPIRY, NULL_HANDLE, NULL_HANDLE}, ArenaAllocator<Node>(arena)),
+          firstHead(static_cast<OrderHandle>(capacity)) {
+        for (OrderHandle head = firstHead; head < nodes.size(); head++) {
+            nodes[head].prev = nodes[head].next = head;
+        }
+    }
+    
+    static size_t arenaBytes(size_t capacity) {
+        return Arena::footprint((capacity + LEVELS * SLOTS) * sizeof(Node));
+    }
+    
+    EngineTime getTime() const { return now; }
+    
+    // Arm the timer of a pool slot; expiry must lie after now
+    void schedule(OrderHandle handle, EngineTime expiry) {
+        nodes[handle].expiry = expiry;
+        place(handle);
+        highWater = max(highWater, ++scheduled);
+    }
+    
+    // Disarm a pool slot's timer; does nothing if it is not scheduled
+    void cancel(OrderHandle handle) {
+        Node& node = nodes[handle];
+        if (node.prev == NULL_HANDLE) {
+            return;
+        }
+        nodes[node.prev].next = node.next;
+        nodes[node.next].prev = node.prev;
+        // Unlinking the last node leaves its slot's head pointing at itself
+        if (node.prev == node.next && node.prev >= firstHead) {
+            size_t index = node.prev - firstHead;
+            occupied[index / SLOTS][(index % SLOTS) >> 6] &= ~(1ULL << (index & 63));
+        }
+        node.prev = node.next = NULL_HANDLE;
+        node.expiry = NO_EXPIRY;
+        scheduled--;
+    }
+    
+    // NO_EXPIRY if the slot has no timer
+    EngineTime expiryOf(OrderHandle handle) const { return nodes[handle].expiry; }
+    
+    // Move the clock to time, calling onExpire(handle) for every timer due by then in
+    // expiry order. Each fired timer is disarmed before its callback runs.
+    template <typename OnExpire>
+    void advance(EngineTime time, OnExpire&& onExpire) {
+        while (now < time) {
+            EngineTime next = nextEvent();
+            if (next > time) {
+                now = time;
+                return;
+            }
+            now = next;
+            // Higher-level slots starting now hand their timers down, to fire now or later
+            for (size_t level = LEVELS - 1; level > 0; level--) {
+                if ((now & ((EngineTime(1) << (SLOT_BITS * level)) - 1)) != 0) {
+                    continue;
+                }
+                for (OrderHandle handle = detach(level, slotOf(now, level)); handle != NULL_HANDLE;) {
+                    OrderHandle following = nodes[handle].next;
+                    place(handle);
+                    handle = following;
+                }
+            }
+            for (OrderHandle handle = detach(0, slotOf(now, 0)); handle != NULL_HANDLE;) {
+                OrderHandle following = nodes[handle].next;
+                nodes[handle] = Node{NO_EXPIRY, NULL_HANDLE, NULL_HANDLE};
+                scheduled--;
+                onExpire(handle);
+                handle = following;
+            }
+        }
+    }
+    
+    ContainerStats stats() const {
+        return ContainerStats{firstHead, scheduled, highWater, nodes.size() * sizeof(Node),
+                              scheduled * sizeof(Node), false};
+    }
+};
+
+// ================================= LevelBitmap Class =================================
+
+// Hierarchical bitmap of occupied price levels. Each layer keeps one bit per 64-bit word of
+// the layer below, so the next occupied level in either direction is found with a handful of
+// find-first-set instructions (one per layer) however sparse the ladder is.
+class LevelBitmap {
+private:
+    vector<ArenaVector<uint64_t>> layers; // layers[0] holds one bit per level
+
+public:
+    static constexpr size_t NPOS = numeric_limits<size_t>::max();
+    
+    LevelBitmap(size_t size, Arena& arena) {
+        do {
+            size = (size + 63) / 64;
+            layers.emplace_back(size, 0, ArenaAllocator<uint64_t>(arena));
+        } while (size > 1);
+    }
+    
+    static size_t arenaBytes(size_t size) {
+        size_t bytes = 0;
+        do {
+            size = (size + 63) / 64;
+            bytes += Arena::footprint(size * sizeof(uint64_t));
+        } while (size > 1);
+        return bytes;
+    }
+    
+    void set(size_t index) {
+        for (auto& layer : layers) {
+            uint64_t& word = layer[index >> 6];
+            bool wasEmpty = word == 0;
+            word |= 1ULL << (index & 63);
+            if (!wasEmpty) {
+                return;
+            }
+            index >>= 6;
+        }
+    }
+    
+    void clear(size_t index) {
+        for (auto& layer : layers) {
+            uint64_t& word = layer[index >> 6];
+            word &= ~(1ULL << (index & 63));
+            if (word != 0) {
+                return;
+            }
+            index >>= 6;
+        }
+    }
+    
+    // Lowest set index >= from, or NPOS
+    size_t findNext(size_t from) const {
+        size_t index = from;
+        for (size_t level = 0; level < layers.size(); level++) {
+            size_t word = index >> 6;
+            if (word >= layers[level].size()) {
+                return NPOS;
+            }
+            uint64_t bits = layers[level][word] & (~0ULL << (index & 63));
+            if (bits != 0) {
+                index = (word << 6) + __builtin_ctzll(bits);
+                while (level-- > 0) {
+                    index = (index << 6) + __builtin_ctzll(layers[level][index]);
+                }
+                return index;
+            }
+            index = word + 1;
+        }
+        return NPOS;
+    }
+    
+    // Highest set index <= from, or NPOS
+    size_t findPrev(size_t from) const {
+        size_t index = from;
+        for (size_t level = 0; level < layers.size(); level++) {
+            size_t word = index >> 6;
+            uint64_t keep = (index & 63) == 63 ? ~0ULL : (1ULL << ((index & 63) + 1)) - 1;
+            uint64_t bits = layers[level][word] & keep;
+            if (bits != 0) {
+                index = (word << 6) + 63 - __builtin_clzll(bits);
+                while (level-- > 0) {
+                    index = (index << 6) + 63 - __builtin_clzll(layers[level][index]);
+                }
+                return index;
+            }
+            if (word == 0) {
+                return NPOS;
+            }
+            index = word - 1;
+        }
+        return NPOS;
+    }
+};
+
+// ================================= PriceLadder Class =================================
+
+enum class BookMode : uint8_t {
+    Dense,  // One slot per tick across the whole price band
+    Hybrid  // A ring of slots centred on the market, plus an ordered overflow map for far prices
+};
+
+// One side's price levels. Levels inside the window are stored as structure-of-arrays
+// (queue heads, queue tails, aggregate quantity, order count), one slot per tick with the
+// slot at price & (ring size - 1). Range questions about liquidity then stream through the
+// quantity array alone, eight levels per AVX2 step where available.
+//
+// In dense mode the window covers the whole price band and never moves. In hybrid mode it
+// is a ring of a few thousand ticks that recentres on the mid as the market moves; levels
+// that fall outside it wait in an ordered overflow map, so memory stays bounded however
+// wide the band is while operations near the touch stay O(1).
+class PriceLadder {
+private:
+    static constexpr Price MID_SMOOTHING = 64; // Each new mid moves the average 1/64 of the way
+    
+    // A level parked outside the window
+    struct OverflowLevel {
+        OrderHandle head = NULL_HANDLE;
+        OrderHandle tail = NULL_HANDLE;
+        uint64_t quantity = 0;
+        uint64_t reserve = 0;
+        uint32_t orderCount = 0;
+    };
+    
+    ArenaVector<OrderHandle> heads;      // Oldest order at each slot (time priority)
+    ArenaVector<OrderHandle> tails;      // Newest order at each slot
+    ArenaVector<uint64_t> quantities;    // Total resting quantity per slot
+    ArenaVector<uint64_t> reserves;      // Hidden iceberg reserve behind that quantity
+    ArenaVector<uint32_t> orderCounts;   // Resting orders per slot
+    LevelBitmap occupied;           // Non-empty slots, for jumping to the next best price
+    map<Price, OverflowLevel> overflow;
+    
+    BookMode mode;
+    Price bandMax;                  // Highest price in the instrument's band
+    size_t slotMask;                // Ring size - 1
+    Price windowBase = 0;           // Lowest price held in the window
+    int64_t midSum = 0;             // Moving average of the mid, times MID_SMOOTHING; 0 until set
+    
+    size_t levelCount = 0;          // Occupied levels, window and overflow
+    size_t windowHighWater = 0;
+    size_t overflowHighWater = 0;
+
+public:
+    PriceLadder(Price maxPrice, BookMode bookMode, size_t ringLevels, Arena& arena)
+        : heads(ringSize(maxPrice, bookMode, ringLevels), NULL_HANDLE, ArenaAllocator<OrderHandle>(arena)),
+          tails(heads.size(), NULL_HANDLE, ArenaAllocator<OrderHandle>(arena)),
+          quantities(heads.size(), 0, ArenaAllocator<uint64_t>(arena)),
+          reserves(heads.size(), 0, ArenaAllocator<uint64_t>(arena)),
+          orderCounts(heads.size(), 0, ArenaAllocator<uint32_t>(arena)),
+          occupied(heads.size(), arena),
+          mode(bookMode),
+          bandMax(maxPrice),
+          slotMask(heads.size() - 1) {}
+    
+    // Only the slot arrays come from the arena; hybrid overflow levels are map nodes on
+    // the global heap, however many are parked
+    static size_t arenaBytes(Price maxPrice, BookMode bookMode, size_t ringLevels) {
+        size_t size = ringSize(maxPrice, bookMode, ringLevels);
+        return 2 * Arena::footprint(size * sizeof(OrderHandle)) + 2 * Arena::footprint(size * sizeof(uint64_t)) +
+               Arena::footprint(size * sizeof(uint32_t)) + LevelBitmap::arenaBytes(size);
+    }
+    
+    OrderHandle& head(Price price) { return inWindow(price) ? heads[slot(price)] : overflow[price].head; }
+    OrderHandle& tail(Price price) { return inWindow(price) ? tails[slot(price)] : overflow[price].tail; }
+    uint64_t& quantity(Price price) { return inWindow(price) ? quantities[slot(price)] : overflow[price].quantity; }
+    uint64_t& reserve(Price price) { return inWindow(price) ? reserves[slot(price)] : overflow[price].reserve; }
+    uint32_t& orderCount(Price price) { return inWindow(price) ? orderCounts[slot(price)] : overflow[price].orderCount; }
+    
+    OrderHandle head(Price price) const {
+        return inWindow(price) ? heads[slot(price)] : findOverflow(price).head;
+    }
+    
+    OrderHandle tail(Price price) const {
+        return inWindow(price) ? tails[slot(price)] : findOverflow(price).tail;
+    }
+    
+    uint64_t quantity(Price price) const {
+        return inWindow(price) ? quantities[slot(price)] : findOverflow(price).quantity;
+    }
+    
+    uint64_t reserve(Price price) const {
+        return inWindow(price) ? reserves[slot(price)] : findOverflow(price).reserve;
+    }
+    
+    uint32_t orderCount(Price price) const {
+        return inWindow(price) ? orderCounts[slot(price)] : findOverflow(price).orderCount;
+    }
+    
+    bool isEmpty(Price price) const { return head(price) == NULL_HANDLE; }
+    Price maxPrice() const { return bandMax; }
+    
+    void markOccupied(Price price) {
+        if (inWindow(price)) {
+            occupied.set(slot(price));
+        }
+        levelCount++;
+        updateHighWater();
+    }
+    
+    void markEmpty(Price price) {
+        if (inWindow(price)) {
+            occupied.clear(slot(price));
+        } else {
+            overflow.erase(price);
+        }
+        levelCount--;
+    }
+    
+    // Levels in the window: capacity is the slot count, and the bytes include the bitmap
+    ContainerStats levelStats() const {
+        size_t slotCount = slotMask + 1;
+        size_t inWindow = levelCount - overflow.size();
+        size_t bytesPerSlot = 2 * sizeof(OrderHandle) + 2 * sizeof(uint64_t) + sizeof(uint32_t);
+        return ContainerStats{slotCount, inWindow, windowHighWater,
+                              arenaBytes(bandMax, mode, slotCount), inWindow * bytesPerSlot, false};
+    }
+    
+    // Levels parked outside the window, one heap node each
+    ContainerStats overflowStats() const {
+        size_t nodeBytes = sizeof(pair<const Price, OverflowLevel>) + 4 * sizeof(void*); // Payload + tree links
+        return ContainerStats{overflow.size(), overflow.size(), overflowHighWater,
+                              overflow.size() * nodeBytes, overflow.size() * nodeBytes, true};
+    }
+    
+    // Nearest occupied level strictly below / above price, or NO_PRICE
+    Price nextBelow(Price price) const {
+        Price found = findPrevInWindow(windowBase, min(price - 1, windowTop()));
+        if (!overflow.empty()) {
+            auto it = overflow.lower_bound(price);
+            if (it != overflow.begin()) {
+                found = max(found, prev(it)->first);
+            }
+        }
+        return found;
+    }
+    
+    Price nextAbove(Price price) const {
+        Price found = findNextInWindow(max(price + 1, windowBase), min(windowTop(), bandMax));
+        if (!overflow.empty()) {
+            auto it = overflow.upper_bound(price);
+            if (it != overflow.end() && (found == NO_PRICE || it->first < found)) {
+                found = it->first;
+            }
+        }
+        return found;
+    }
+    
+    // Hybrid mode: recentre the window once the market has drifted out of its middle half.
+    // The window follows a moving average of the mid rather than the mid itself: with a wide
+    // spread the mid jumps by thousands of ticks every time an order lands inside it, and
+    // chasing each jump would repark most of the book back and forth. A sustained move
+    // still carries the average, and the window, along with it. Levels leaving the window
+    // move to the overflow map and overflow levels now inside it move into their slots;
+    // cost is proportional to the levels moved.
+    void follow(Price mid) {
+        if (mode != BookMode::Hybrid) {
+            return;
+        }
+        // Kept scaled by MID_SMOOTHING so a steady mid is reached exactly, not to within a step
+        midSum = midSum == 0 ? static_cast<int64_t>(mid) * MID_SMOOTHING : midSum + mid - midSum / MID_SMOOTHING;
+        mid = static_cast<Price>(midSum / MID_SMOOTHING);
+        Price ring = static_cast<Price>(slotMask + 1);
+        if (mid >= windowBase + ring / 4 && mid < windowBase + ring - ring / 4) {
+            return;
+        }
+        Price newBase = max<Price>(0, mid - ring / 2);
+        
+        // Park occupied levels that fall outside the new window
+        Price leaveLow = newBase > windowBase ? windowBase : max(windowBase, newBase + ring);
+        Price leaveHigh = newBase > windowBase ? min(windowTop(), newBase - 1) : windowTop();
+        for (Price price = findNextInWindow(leaveLow, leaveHigh); price != NO_PRICE;
+             price = price < leaveHigh ? findNextInWindow(price + 1, leaveHigh) : NO_PRICE) {
+            size_t index = slot(price);
+            overflow[price] = OverflowLevel{heads[index], tails[index], quantities[index], reserves[index],
+                                            orderCounts[index]};
+            clearSlot(index);
+        }
+        windowBase = newBase;
+        
+        // Pull in parked levels the window now covers
+        auto it = overflow.lower_bound(windowBase);
+        while (it != overflow.end() && it->first <= windowTop()) {
+            size_t index = slot(it->first);
+            heads[index] = it->second.head;
+            tails[index] = it->second.tail;
+            quantities[index] = it->second.quantity;
+            reserves[index] = it->second.reserve;
+            orderCounts[index] = it->second.orderCount;
+            occupied.set(index);
+            it = overflow.erase(it);
+        }
+        updateHighWater();
+    }
+    
+    // Total resting quantity on levels low..high inclusive
+    uint64_t sumQuantity(Price low, Price high) const {
+        low = max<Price>(low, NO_PRICE + 1);
+        high = min(high, bandMax);
+        uint64_t total = 0;
+        Price windowLow = max(low, windowBase);
+        Price windowHigh = min(high, windowTop());
+        if (windowLow <= windowHigh) {
+            size_t lowSlot = slot(windowLow);
+            size_t highSlot = slot(windowHigh);
+            if (lowSlot <= highSlot) {
+                total += sumSlots(lowSlot, highSlot);
+            } else {
+                total += sumSlots(lowSlot, slotMask) + sumSlots(0, highSlot);
+            }
+        }
+        for (auto it = overflow.lower_bound(low); it != overflow.end() && it->first <= high; ++it) {
+            total += it->second.quantity;
+        }
+        return total;
+    }
+    
+    // Walk away from start (downwards for bids, upwards for asks) accumulating quantity and
+    // return the first price at which at least target is available, or NO_PRICE if the
+    // whole side holds less. available receives the quantity counted up to that point.
+    // withReserve counts hidden iceberg reserve as well as displayed quantity.
+    Price findFillPrice(Price start, bool downwards, uint64_t target, uint64_t& available,
+                        bool withReserve = false) const {
+        available = 0;
+        if (target == 0 || start <= NO_PRICE || start > bandMax) {
+            return NO_PRICE;
+        }
+        if (downwards) {
+            // Parked levels above the window, then the window, then parked levels below it
+            for (auto it = overflow.upper_bound(start); it != overflow.begin();) {
+                --it;
+                if (it->first <= windowTop()) {
+                    break;
+                }
+                if ((available += levelTotal(it->second, withReserve)) >= target) {
+                    return it->first;
+                }
+            }
+            Price found = scanWindow(max<Price>(windowBase, NO_PRICE + 1), min(start, windowTop()),
+                                     true, target, available, withReserve);
+            if (found != NO_PRICE) {
+                return found;
+            }
+            auto below = start < windowBase ? overflow.upper_bound(start) : overflow.lower_bound(windowBase);
+            for (auto it = below; it != overflow.begin();) {
+                --it;
+                if ((available += levelTotal(it->second, withReserve)) >= target) {
+                    return it->first;
+                }
+            }
+        } else {
+            for (auto it = overflow.lower_bound(start); it != overflow.end() && it->first < windowBase; ++it) {
+                if ((available += levelTotal(it->second, withReserve)) >= target) {
+                    return it->first;
+                }
+            }
+            Price found = scanWindow(max(start, windowBase), min(windowTop(), bandMax), false, target, available,
+                                     withReserve);
+            if (found != NO_PRICE) {
+                return found;
+            }
+            auto above = start > windowTop() ? overflow.lower_bound(start) : overflow.upper_bound(windowTop());
+            for (auto it = above; it != overflow.end(); ++it) {
+                if ((available += levelTotal(it->second, withReserve)) >= target) {
+                    return it->first;
+                }
+            }
+        }
+        return NO_PRICE;
+    }
+
+private:
+    static size_t ringSize(Price maxPrice, BookMode bookMode, size_t ringLevels) {
+        size_t wanted = bookMode == BookMode::Dense ? static_cast<size_t>(maxPrice) + 1 : ringLevels;
+        size_t size = 64;
+        while (size < wanted) {
+            size <<= 1;
+        }
+        return size;
+    }
+    
+    size_t slot(Price price) const { return static_cast<size_t>(price) & slotMask; }
+    
+    void updateHighWater() {
+        windowHighWater = max(windowHighWater, levelCount - overflow.size());
+        overflowHighWater = max(overflowHighWater, overflow.size());
+    }
+    Price windowTop() const { return windowBase + static_cast<Price>(slotMask); }
+    bool inWindow(Price price) const { return price >= windowBase && price <= windowTop(); }
+    
+    static uint64_t levelTotal(const OverflowLevel& level, bool withReserve) {
+        return level.quantity + (withReserve ? level.reserve : 0);
+    }
+    
+    uint64_t slotTotal(size_t index, bool withReserve) const {
+        return quantities[index] + (withReserve ? reserves[index] : 0);
+    }
+    
+    const OverflowLevel& findOverflow(Price price) const {
+        static const OverflowLevel emptyLevel;
+        auto it = overflow.find(price);
+        return it == overflow.end() ? emptyLevel : it->second;
+    }
+    
+    void clearSlot(size_t index) {
+        heads[index] = tails[index] = NULL_HANDLE;
+        quantities[index] = 0;
+        reserves[index] = 0;
+        orderCounts[index] = 0;
+        occupied.clear(index);
+    }
+    
+    // Highest / lowest occupied price in low..high, both inside the window, or NO_PRICE.
+    // The prices map to at most two contiguous slot runs when the range wraps the ring.
+    Price findPrevInWindow(Price low, Price high) const {
+        if (low > high) {
+            return NO_PRICE;
+        }
+        size_t lowSlot = slot(low);
+        size_t highSlot = slot(high);
+        size_t found = occupied.findPrev(highSlot);
+        if (lowSlot <= highSlot) {
+            return found != LevelBitmap::NPOS && found >= lowSlot ? high - static_cast<Price>(highSlot - found) : NO_PRICE;
+        }
+        if (found != LevelBitmap::NPOS) {
+            return high - static_cast<Price>(highSlot - found);
+        }
+        found = occupied.findPrev(slotMask);
+        return found != LevelBitmap::NPOS && found >= lowSlot
+            ? high - static_cast<Price>(highSlot + slotMask + 1 - found) : NO_PRICE;
+    }
+    
+    Price findNextInWindow(Price low, Price high) const {
+        if (low > high) {
+            return NO_PRICE;
+        }
+        size_t lowSlot = slot(low);
+        size_t highSlot = slot(high);
+        size_t found = occupied.findNext(lowSlot);
+        if (lowSlot <= highSlot) {
+            return found != LevelBitmap::NPOS && found <= highSlot ? low + static_cast<Price>(found - lowSlot) : NO_PRICE;
+        }
+        if (found != LevelBitmap::NPOS) {
+            return low + static_cast<Price>(found - lowSlot);
+        }
+        found = occupied.findNext(0);
+        return found != LevelBitmap::NPOS && found <= highSlot
+            ? low + static_cast<Price>(slotMask + 1 - lowSlot + found) : NO_PRICE;
+    }
+    
+    // Fill scan over window prices low..high, split into contiguous slot runs
+    Price scanWindow(Price low, Price high, bool downwards, uint64_t target, uint64_t& available,
+                     bool withReserve) const {
+        if (low > high) {
+            return NO_PRICE;
+        }
+        size_t lowSlot = slot(low);
+        size_t highSlot = slot(high);
+        size_t found = LevelBitmap::NPOS;
+        if (lowSlot <= highSlot) {
+            found = scanSlots(lowSlot, highSlot, downwards, target, available, withReserve);
+        } else if (downwards) {
+            found = scanSlots(0, highSlot, true, target, available, withReserve);
+            if (found == LevelBitmap::NPOS) {
+                found = scanSlots(lowSlot, slotMask, true, target, available, withReserve);
+            }
+        } else {
+            found = scanSlots(lowSlot, slotMask, false, target, available, withReserve);
+            if (found == LevelBitmap::NPOS) {
+                found = scanSlots(0, highSlot, false, target, available, withReserve);
+            }
+        }
+        if (found == LevelBitmap::NPOS) {
+            return NO_PRICE;
+        }
+        // Map the slot back to the price it holds inside low..high
+        return low + static_cast<Price>((found - lowSlot) & slotMask);
+    }
+    
+    uint64_t sumSlots(size_t first, size_t last) const {
+        uint64_t total = 0;
+        size_t index = first;
+#ifdef __AVX2__
+        __m256i accumulator = _mm256_setzero_si256();
+        for (; index + 7 <= last; index += 8) {
+            accumulator = _mm256_add_epi64(accumulator, _mm256_add_epi64(
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&quantities[index])),
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&quantities[index + 4]))));
+        }
+        total = horizontalSum(accumulator);
+#endif
+        for (; index <= last; index++) {
+            total += quantities[index];
+        }
+        return total;
+    }
+    
+    // Accumulate slots first..last in the given direction until target is reached;
+    // returns the slot that completes it, or NPOS
+    size_t scanSlots(size_t first, size_t last, bool downwards, uint64_t target, uint64_t& available,
+                     bool withReserve) const {
+        if (downwards) {
+            size_t index = last + 1; // One past the next slot to read
+#ifdef __AVX2__
+            // Skip whole blocks of eight levels while they cannot complete the fill
+            for (; index >= first + 8; index -= 8) {
+                uint64_t block = blockSum(quantities, index - 8) +
+                                 (withReserve ? blockSum(reserves, index - 8) : 0);
+                if (available + block >= target) {
+                    break;
+                }
+                available += block;
+            }
+#endif
+            for (; index > first; index--) {
+                if ((available += slotTotal(index - 1, withReserve)) >= target) {
+                    return index - 1;
+                }
+            }
+        } else {
+            size_t index = first;
+#ifdef __AVX2__
+            for (; index + 7 <= last; index += 8) {
+                uint64_t block = blockSum(quantities, index) + (withReserve ? blockSum(reserves, index) : 0);
+                if (available + block >= target) {
+                    break;
+                }
+                available += block;
+            }
+#endif
+            for (; index <= last; index++) {
+                if ((available += slotTotal(index, withReserve)) >= target) {
+                    return index;
+                }
+            }
+        }
+        return LevelBitmap::NPOS;
+    }
+    
+#ifdef __AVX2__
+    static uint64_t horizontalSum(__m256i values) {
+        __m128i pairs = _mm_add_epi64(_mm256_castsi256_si128(values), _mm256_extracti128_si256(values, 1));
+        return static_cast<uint64_t>(_mm_cvtsi128_si64(pairs)) + static_cast<uint64_t>(_mm_extract_epi64(pairs, 1));
+    }
+    
+    // Sum of the eight slots of values starting at first
+    static uint64_t blockSum(const ArenaVector<uint64_t>& values, size_t first) {
+        return horizontalSum(_mm256_add_epi64(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&values[first])),
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&values[first + 4]))));
+    }
+#endif
+};
+
+// ================================= EngineConfig Struct =================================
+
+// What happens to the order pushed out when a side reaches its resting-order cap
+enum class EvictionPolicy : uint8_t {
+    Drop,   // Discard it
+    Archive // Append it to the archive file, then discard it
+};
+
+// Startup sizing and layout options for the engine and its books
+struct EngineConfig {
+    size_t maxOrders = 1000000;         // Resting order capacity (--max-orders)
+    BookMode bookMode = BookMode::Dense; // Level storage layout (--book-mode)
+    size_t ringLevels = 4096;           // Hybrid mode: ticks held in the ring around the mid (--ring-levels)
+    size_t arenaBytes = 0;              // Storage arena size, 0 to size it for the book (--arena-size)
+    string tradeLogPath = "trades.log"; // Trade log file
+    bool echo = true;                   // Print accepted orders, trades, cancels and rejects to the console
+    size_t maxOrdersPerSide = 0;        // Resting orders per side of a book, 0 for no cap (--side-cap)
+    EvictionPolicy evictionPolicy = EvictionPolicy::Drop; // (--evict)
+    string archivePath = "evicted_orders.log";            // Archive policy destination
+};
+
+// Inside market for one side: the best price with the size and order count resting there
+struct TopOfBook {
+    Price price = NO_PRICE;
+    uint64_t totalQuantity = 0;
+    uint32_t orderCount = 0;
+};
+
+// One row of aggregated (L2) market depth has the same shape as the top of book
+using DepthLevel = TopOfBook;
+
+// ================================= OrderBook Class =================================
+
+class OrderBook {
+public:
+    // Forward iterator over one side's resting orders in priority order: best price first,
+    // then time priority within the level. It reads the book in place (no copies, no
+    // allocation) and stops after a caller-chosen number of orders.
+    class OrderIterator {
+    public:
+        using iterator_category = forward_iterator_tag;
+        using value_type = Order;
+        using difference_type = ptrdiff_t;
+        using pointer = const Order*;
+        using reference = const Order&;
+        
+        OrderIterator() = default;
+        
+        OrderIterator(const OrderBook* orderBook, bool buySide, size_t limit)
+            : book(orderBook), isBuy(buySide), remaining(limit) {
+            if (remaining > 0 && (isBuy ? book->buyOrderCount : book->sellOrderCount) > 0) {
+                price = isBuy ? book->bestBid.price : book->bestAsk.price;
+                handle = book->ladderOf(isBuy).head(price);
+            }
+        }
+        
+        reference operator*() const { return book->pool[handle]; }
+        pointer operator->() const { return &book->pool[handle]; }
+        
+        OrderIterator& operator++() {
+            if (--remaining == 0) {
+                handle = NULL_HANDLE;
+                return *this;
+            }
+            handle = book->pool.linksOf(handle).next;
+            if (handle == NULL_HANDLE) {
+                price = book->nextLevel(isBuy, price);
+                if (price != NO_PRICE) {
+                    handle = book->ladderOf(isBuy).head(price);
+                }
+            }
+            return *this;
+        }
+        
+        OrderIterator operator++(int) {
+            OrderIterator previous = *this;
+            ++*this;
+            return previous;
+        }
+        
+        bool operator==(const OrderIterator& other) const { return handle == other.handle; }
+        bool operator!=(const OrderIterator& other) const { return handle != other.handle; }
+    
+    private:
+        const OrderBook* book = nullptr;
+        bool isBuy = true;
+        size_t remaining = 0;
+        Price price = NO_PRICE;
+        OrderHandle handle = NULL_HANDLE;
+    };
+    
+    // View of the best orders on one side, for use in range-based for loops
+    class OrderRange {
+    public:
+        OrderRange(const OrderBook* orderBook, bool buySide, size_t limit)
+            : book(orderBook), isBuy(buySide), maxOrders(limit) {}
+        
+        OrderIterator begin() const { return OrderIterator(book, isBuy, maxOrders); }
+        OrderIterator end() const { return OrderIterator(); }
+    
+    private:
+        const OrderBook* book;
+        bool isBuy;
+        size_t maxOrders;
+    };
+
+private:
+    Instrument instrument;
+    SymbolId symbol;
+    
+    // Resting orders live in the engine's pool, shared by every book; levels link them by handle
+    OrderPool& pool;
+    OrderIndex& orderIndex; // orderID -> handle, engine-wide
+    TimerWheel& timers;     // GTD expiries, one node per pool slot
+    
+    // Price ladders covering the instrument's price band
+    PriceLadder buyLadder;
+    PriceLadder sellLadder;
+    
+    // Cached best bid/ask, refreshed only when the level at the touch changes
+    TopOfBook bestBid;
+    TopOfBook bestAsk;
+    
+    size_t buyOrderCount = 0;
+    size_t sellOrderCount = 0;
+    size_t buyOrderHighWater = 0;
+    size_t sellOrderHighWater = 0;
+    size_t dayOrderCount = 0; // Resting DAY orders, both sides
+    
+    Price lastTradePrice = NO_PRICE; // Latest fill in this book; NO_PRICE until the first
+
+public:
+    OrderBook(const Instrument& bookInstrument, SymbolId bookSymbol, const EngineConfig& config,
+              OrderPool& orderPool, OrderIndex& index, TimerWheel& expiries, Arena& arena)
+        : instrument(bookInstrument),
+          symbol(bookSymbol),
+          pool(orderPool),
+          orderIndex(index),
+          timers(expiries),
+          buyLadder(bookInstrument.maxPrice, config.bookMode, config.ringLevels, arena),
+          sellLadder(bookInstrument.maxPrice, config.bookMode, config.ringLevels, arena) {}
+    
+    // Arena space the book's own storage (its two ladders) needs under the given configuration
+    static size_t arenaBytes(const Instrument& instrument, const EngineConfig& config) {
+        return 2 * PriceLadder::arenaBytes(instrument.maxPrice, config.bookMode, config.ringLevels);
+    }
+    
+    const Instrument& getInstrument() const { return instrument; }
+    
+    void addBuyOrder(const Order& order) {
+        insertOrder(order);
+    }
+    
+    void addSellOrder(const Order& order) {
+        insertOrder(order);
+    }
+    
+    // Side-templated accessors for the matching core; the side is fixed at compile time
+    template <Side S>
+    bool hasOrders() const {
+        return (S == Side::Buy ? buyOrderCount : sellOrderCount) > 0;
+    }
+    
+    template <Side S>
+    const TopOfBook& getBest() const {
+        if constexpr (S == Side::Buy) {
+            return bestBid;
+        } else {
+            return bestAsk;
+        }
+    }
+    
+    template <Side S>
+    const Order& peekTop() const {
+        return pool[ladderOf(S == Side::Buy).head(getBest<S>().price)];
+    }
+    
+    // Fill part or all of the order at the head of the best level. A partial fill reduces it
+    // where it sits, so it keeps its place; only a fully filled order leaves the book (an
+    // iceberg with reserve left shows its next slice instead, stamped with fillTime).
+    template <Side S>
+    void fillTop(Quantity fillQuantity, uint64_t fillTime) {
+        fillOrder(ladderOf(S == Side::Buy).head(getBest<S>().price), fillQuantity, fillTime);
+    }
+    
+    // Execute an incoming order against this side (S is the resting side) as far as its
+    // limit allows, appending one Trade per fill in price-time order; returns the unfilled
+    // quantity. Each level whose aggregate the order covers is cleared whole in one pass
+    // over its queue (index erase and slot release per order, but no unlinking and no
+    // best-price update between orders); only the level where the order runs out is filled
+    // order by order. Icebergs in a cleared level replenish and stay, so the level is taken
+    // again until it empties or outgrows the order.
+    template <Side S>
+    Quantity sweep(const Order& incoming, vector<Trade>& trades) {
+        using Incoming = SideTraits<SideTraits<S>::opposite>;
+        constexpr bool isBuy = S == Side::Buy;
+        PriceLadder& ladder = ladderOf(isBuy);
+        TopOfBook& best = isBuy ? bestBid : bestAsk;
+        size_t& restingCount = isBuy ? buyOrderCount : sellOrderCount;
+        Quantity remaining = incoming.quantity;
+        if (remaining == 0 || restingCount == 0 || !Incoming::crosses(incoming.price, best.price)) {
+            return remaining;
+        }
+        
+        Price price = best.price;
+        bool clearedAny = false;
+        while (price != NO_PRICE && Incoming::crosses(incoming.price, price) && ladder.quantity(price) <= remaining) {
+            remaining -= static_cast<Quantity>(ladder.quantity(price));
+            restingCount -= filterLevel(ladder, price, [&](Order& resting) {
+                trades.push_back(isBuy ? Trade{resting.orderID, incoming.orderID, price, resting.quantity}
+                                       : Trade{incoming.orderID, resting.orderID, price, resting.quantity});
+                if (resting.reserveQuantity == 0) {
+                    return false;
+                }
+                showNextSlice(resting, incoming.timestamp);
+                return true;
+            });
+            if (ladder.isEmpty(price)) {
+                price = nextLevel(isBuy, price);
+            }
+            clearedAny = true;
+        }
+        
+        if (clearedAny) {
+            if (restingCount == 0) {
+                best = TopOfBook();
+            } else {
+                best.price = price;
+                refreshTopIfAt(isBuy, price);
+                followMarket();
+            }
+        }
+        
+        // The last level: fill from the head of its queue until the order is done
+        while (remaining > 0 && restingCount > 0 && Incoming::crosses(incoming.price, best.price)) {
+            const Order& resting = peekTop<S>();
+            Quantity fillQuantity = min(remaining, resting.quantity);
+            trades.push_back(isBuy ? Trade{resting.orderID, incoming.orderID, best.price, fillQuantity}
+                                   : Trade{incoming.orderID, resting.orderID, best.price, fillQuantity});
+            remaining -= fillQuantity;
+            fillTop<S>(fillQuantity, incoming.timestamp);
+        }
+        if (remaining < incoming.quantity) {
+            lastTradePrice = trades.back().price;
+        }
+        return remaining;
+    }
+    
+    bool hasBuyOrders() const { return hasOrders<Side::Buy>(); }
+    bool hasSellOrders() const { return hasOrders<Side::Sell>(); }
+    
+    const TopOfBook& getBestBid() const { return bestBid; }
+    const TopOfBook& getBestAsk() const { return bestAsk; }
+    Price getLastTradePrice() const { return lastTradePrice; }
+    
+    const Order& peekTopBuyOrder() const { return peekTop<Side::Buy>(); }
+    const Order& peekTopSellOrder() const { return peekTop<Side::Sell>(); }
+    
+    // Look up a resting order by ID; returns nullptr if it is not in the book
+    const Order* findOrder(int orderID) const {
+        OrderHandle handle = findHandle(orderID);
+        return handle == NULL_HANDLE ? nullptr : &pool[handle];
+    }
+    
+    // Remove a resting order by ID in constant time; returns false if it is not in the book
+    bool cancelOrder(int orderID) {
+        OrderHandle handle = findHandle(orderID);
+        if (handle == NULL_HANDLE) {
+            return false;
+        }
+        removeOrder(handle);
+        return true;
+    }
+    
+    // Shrink a resting order where it sits, keeping its place in the level queue. For an
+    // iceberg newQuantity is the new total: the hidden reserve is cut first, then the slice.
+    bool reduceOrderQuantity(int orderID, Quantity newQuantity) {
+        OrderHandle handle = findHandle(orderID);
+        if (handle == NULL_HANDLE || newQuantity == 0 || newQuantity > totalQuantity(pool[handle])) {
+            return false;
+        }
+        Order& order = pool[handle];
+        bool isBuy = order.side == Side::Buy;
+        Quantity cut = totalQuantity(order) - newQuantity;
+        Quantity fromReserve = min(cut, order.reserveQuantity);
+        order.reserveQuantity -= fromReserve;
+        cut -= fromReserve;
+        ladderOf(isBuy).reserve(order.price) -= fromReserve;
+        ladderOf(isBuy).quantity(order.price) -= cut;
+        order.quantity -= cut;
+        refreshTopIfAt(isBuy, order.price);
+        return true;
+    }
+    
+    // Displayed plus hidden quantity of a resting order
+    static Quantity totalQuantity(const Order& order) {
+        return order.quantity + order.reserveQuantity;
+    }
+    
+    // The best maxOrders resting orders of one side, in priority order
+    OrderRange orders(Side side, size_t maxOrders = numeric_limits<size_t>::max()) const {
+        return OrderRange(this, side == Side::Buy, maxOrders);
+    }
+    
+    void displayOrderBook() const {
+        cout << "\n========== ORDER BOOK: " << instrument.symbol << " ==========\n";
+        displayTopOfBook("BEST BID", bestBid);
+        displayTopOfBook("BEST ASK", bestAsk);
+        cout << "\n";
+        
+        // Walk the ladders in priority order; no copy of the book is needed
+        cout << "BUY ORDERS (Highest price first):\n";
+        if (buyOrderCount == 0) {
+            cout << "  No buy orders\n";
+        } else {
+            for (const Order& order : orders(Side::Buy, 5)) { // Show top 5
+                cout << "  ";
+                order.display(instrument);
+            }
+            if (buyOrderCount > 5) {
+                cout << "  ... and " << (buyOrderCount - 5) << " more buy orders\n";
+            }
+        }
+        
+        cout << "\nSELL ORDERS (Lowest price first):\n";
+        if (sellOrderCount == 0) {
+            cout << "  No sell orders\n";
+        } else {
+            for (const Order& order : orders(Side::Sell, 5)) { // Show top 5
+                cout << "  ";
+                order.display(instrument);
+            }
+            if (sellOrderCount > 5) {
+                cout << "  ... and " << (sellOrderCount - 5) << " more sell orders\n";
+            }
+        }
+        cout << "===============================\n\n";
+    }
+    
+    // Aggregated depth: the best nLevels occupied price levels of one side, best first.
+    // Reads the per-level totals directly, so the cost is O(nLevels) whatever the book size;
+    // pass the same vector on every poll to avoid reallocating it.
+    void getDepth(Side side, size_t nLevels, vector<DepthLevel>& depth) const {
+        bool isBuy = side == Side::Buy;
+        const PriceLadder& ladder = ladderOf(isBuy);
+        
+        depth.clear();
+        for (Price price = isBuy ? bestBid.price : bestAsk.price;
+             price != NO_PRICE && depth.size() < nLevels;
+             price = nextLevel(isBuy, price)) {
+            depth.push_back(DepthLevel{price, ladder.quantity(price), ladder.orderCount(price)});
+        }
+    }
+    
+    vector<DepthLevel> getDepth(Side side, size_t nLevels) const {
+        vector<DepthLevel> depth;
+        depth.reserve(nLevels);
+        getDepth(side, nLevels, depth);
+        return depth;
+    }
+    
+    // Pre-trade impact: total quantity resting within ticks of the best price on one side
+    uint64_t getLiquidityWithin(Side side, Price ticks) const {
+        bool isBuy = side == Side::Buy;
+        const TopOfBook& best = isBuy ? bestBid : bestAsk;
+        if (best.orderCount == 0) {
+            return 0;
+        }
+        return isBuy ? buyLadder.sumQuantity(best.price - ticks, best.price)
+                     : sellLadder.sumQuantity(best.price, best.price + ticks);
+    }
+    
+    // Pre-trade impact: the worst price an incoming order of the given side and size would
+    // reach if it swept the opposite side, or NO_PRICE if there is not enough resting quantity.
+    // Displayed size only, unless withReserve also counts the hidden iceberg reserve a sweep
+    // reaches slice by slice.
+    Price getFillPrice(Side incomingSide, uint64_t quantity, bool withReserve = false) const {
+        bool hitsBids = incomingSide == Side::Sell;
+        const TopOfBook& best = hitsBids ? bestBid : bestAsk;
+        uint64_t available = 0;
+        if (best.orderCount == 0) {
+            return NO_PRICE;
+        }
+        return ladderOf(hitsBids).findFillPrice(best.price, hitsBids, quantity, available, withReserve);
+    }
+    
+    void displayDepth(size_t nLevels) const {
+        cout << "\n========== MARKET DEPTH: " << instrument.symbol << " ==========\n";
+        cout << setw(18) << "BID (orders)" << setw(12) << "PRICE" << "   |   "
+             << left << setw(12) << "PRICE" << "ASK (orders)" << right << "\n";
+        vector<DepthLevel> bids = getDepth(Side::Buy, nLevels);
+        vector<DepthLevel> asks = getDepth(Side::Sell, nLevels);
+        for (size_t i = 0; i < max(bids.size(), asks.size()); i++) {
+            if (i < bids.size()) {
+                ostringstream size;
+                size << bids[i].totalQuantity << " (" << bids[i].orderCount << ")";
+                cout << setw(18) << size.str() << setw(12) << ("$" + instrument.formatPrice(bids[i].price));
+            } else {
+                cout << setw(30) << "";
+            }
+            cout << "   |   ";
+            if (i < asks.size()) {
+                cout << left << setw(12) << ("$" + instrument.formatPrice(asks[i].price)) << right
+                     << asks[i].totalQuantity << " (" << asks[i].orderCount << ")";
+            }
+            cout << "\n";
+        }
+        if (bids.empty() && asks.empty()) {
+            cout << "  Book is empty\n";
+        } else {
+            Price window = static_cast<Price>(llround(1.0 / instrument.tickSize())); // One currency unit
+            cout << "Liquidity within $1 of the touch: bids "
+                 << getLiquidityWithin(Side::Buy, window) << ", asks "
+                 << getLiquidityWithin(Side::Sell, window) << "\n";
+        }
+        cout << "==================================\n\n";
+    }
+    
+    size_t getBuyOrderCount() const { return buyOrderCount; }
+    size_t getSellOrderCount() const { return sellOrderCount; }
+    
+    template <Side S>
+    size_t getOrderCount() const {
+        return S == Side::Buy ? buyOrderCount : sellOrderCount;
+    }
+    
+    // Lowest-priority resting order of a side: the newest order at its worst price
+    // (lowest bid, highest ask); nullptr when the side is empty
+    template <Side S>
+    const Order* worstOrder() const {
+        constexpr bool isBuy = S == Side::Buy;
+        if (getOrderCount<S>() == 0) {
+            return nullptr;
+        }
+        const PriceLadder& ladder = ladderOf(isBuy);
+        Price worst = isBuy ? ladder.nextAbove(NO_PRICE) : ladder.nextBelow(ladder.maxPrice() + 1);
+        return &pool[ladder.tail(worst)];
+    }
+    
+    // End of day: drop every DAY order in a single pass over each side. Each level's queue is
+    // walked once and its survivors relinked, and the best prices are found once at the end,
+    // instead of unlinking and re-pricing order by order as cancels would. Returns the count.
+    size_t expireDayOrders() {
+        if (dayOrderCount == 0) {
+            return 0;
+        }
+        size_t expired = expireDayOrders(true) + expireDayOrders(false);
+        if (expired > 0) {
+            bestBid = TopOfBook();
+            bestAsk = TopOfBook();
+            if (buyOrderCount > 0) {
+                bestBid.price = buyLadder.nextBelow(buyLadder.maxPrice() + 1);
+                refreshTopIfAt(true, bestBid.price);
+            }
+            if (sellOrderCount > 0) {
+                bestAsk.price = sellLadder.nextAbove(NO_PRICE);
+                refreshTopIfAt(false, bestAsk.price);
+            }
+            if (buyOrderCount > 0 || sellOrderCount > 0) {
+                followMarket();
+            }
+        }
+        return expired;
+    }
+    
+    // True when every resting order is a DAY order, so the whole book goes at end of day
+    bool onlyDayOrders() const {
+        return dayOrderCount > 0 && dayOrderCount == buyOrderCount + sellOrderCount;
+    }
+    
+    size_t getDayOrderCount() const { return dayOrderCount; }
+    
+    // Empty both ladders level by level without visiting any order. Only for a book holding
+    // nothing but DAY orders (so no timers are armed): the caller frees their pool slots and
+    // index entries in bulk. Returns the number of orders dropped.
+    size_t clearLevels() {
+        size_t cleared = buyOrderCount + sellOrderCount;
+        for (bool isBuy : {true, false}) {
+            PriceLadder& ladder = ladderOf(isBuy);
+            size_t count = isBuy ? buyOrderCount : sellOrderCount;
+            for (Price price = count > 0 ? (isBuy ? bestBid.price : bestAsk.price) : NO_PRICE; price != NO_PRICE;) {
+                Price next = nextLevel(isBuy, price);
+                ladder.head(price) = ladder.tail(price) = NULL_HANDLE;
+                ladder.quantity(price) = 0;
+                ladder.reserve(price) = 0;
+                ladder.orderCount(price) = 0;
+                ladder.markEmpty(price);
+                price = next;
+            }
+        }
+        bestBid = TopOfBook();
+        bestAsk = TopOfBook();
+        buyOrderCount = sellOrderCount = dayOrderCount = 0;
+        return cleared;
+    }
+    
+    // Footprint and occupancy of the book's own storage (orders are counted in the shared pool)
+    BookStats getStats() const {
+        BookStats stats;
+        stats.symbol = instrument.symbol;
+        stats.bids = SideStats{buyLadder.levelStats(), buyLadder.overflowStats(), buyOrderCount, buyOrderHighWater};
+        stats.asks = SideStats{sellLadder.levelStats(), sellLadder.overflowStats(), sellOrderCount, sellOrderHighWater};
+        return stats;
+    }
+
+private:
+    // The index is shared across books, so an ID only belongs here if its order trades this symbol
+    OrderHandle findHandle(int orderID) const {
+        OrderHandle handle = orderIndex.find(orderID);
+        return handle != NULL_HANDLE && pool[handle].symbol == symbol ? handle : NULL_HANDLE;
+    }
+    
+    // Drop an order that has left its level: index entry, expiry timer and pool slot
+    void releaseOrder(OrderHandle handle) {
+        const Order& order = pool[handle];
+        orderIndex.erase(order.orderID);
+        if (order.timeInForce == TimeInForce::GTD) {
+            timers.cancel(handle);
+        } else if (order.timeInForce == TimeInForce::DAY) {
+            dayOrderCount--;
+        }
+        pool.release(handle);
+    }
+    
+    // Walk one level's queue once, keeping the orders keep(order) returns true for (relinked
+    // in queue order) and releasing the rest. The level's totals are rebuilt from the
+    // survivors and it is marked empty if none are left; best prices and side counts are
+    // the caller's. Returns the number of orders released.
+    template <typename Keep>
+    size_t filterLevel(PriceLadder& ladder, Price price, Keep keep) {
+        OrderHandle keptHead = NULL_HANDLE, keptTail = NULL_HANDLE;
+        uint64_t keptQuantity = 0;
+        uint64_t keptReserve = 0;
+        uint32_t kept = 0;
+        size_t released = 0;
+        for (OrderHandle handle = ladder.head(price); handle != NULL_HANDLE;) {
+            Order& order = pool[handle];
+            OrderHandle next = pool.linksOf(handle).next;
+            if (keep(order)) {
+                pool.linksOf(handle) = OrderLinks{keptTail, NULL_HANDLE};
+                if (keptTail == NULL_HANDLE) {
+                    keptHead = handle;
+                } else {
+                    pool.linksOf(keptTail).next = handle;
+                }
+                keptTail = handle;
+                keptQuantity += order.quantity;
+                keptReserve += order.reserveQuantity;
+                kept++;
+            } else {
+                releaseOrder(handle);
+                released++;
+            }
+            handle = next;
+        }
+        ladder.head(price) = keptHead;
+        ladder.tail(price) = keptTail;
+        ladder.quantity(price) = keptQuantity;
+        ladder.reserve(price) = keptReserve;
+        ladder.orderCount(price) = kept;
+        if (kept == 0) {
+            ladder.markEmpty(price);
+        }
+        return released;
+    }
+    
+    size_t expireDayOrders(bool isBuy) {
+        PriceLadder& ladder = ladderOf(isBuy);
+        size_t& count = isBuy ? buyOrderCount : sellOrderCount;
+        size_t expired = 0;
+        for (Price price = count > 0 ? (isBuy ? bestBid.price : bestAsk.price) : NO_PRICE; price != NO_PRICE;) {
+            Price next = nextLevel(isBuy, price);
+            expired += filterLevel(ladder, price, [](const Order& order) {
+                return order.timeInForce != TimeInForce::DAY;
+            });
+            price = next;
+        }
+        count -= expired;
+        return expired;
+    }
+    
+    // Copy the order into a pool slot, append it to its price level and index it.
+    // The engine checks the shared pool has room before letting an order rest.
+    void insertOrder(const Order& incoming) {
+        OrderHandle handle = pool.allocate(incoming);
+        Order& order = pool[handle];
+        if (order.isIceberg() && order.quantity > order.displayQuantity) {
+            // Only the peak is shown (and counted in the level); the rest waits in reserve
+            order.reserveQuantity = order.quantity - order.displayQuantity;
+            order.quantity = order.displayQuantity;
+        }
+        bool isBuy = order.side == Side::Buy;
+        PriceLadder& ladder = ladderOf(isBuy);
+        Price price = order.price;
+        
+        if (ladder.isEmpty(price)) {
+            ladder.head(price) = ladder.tail(price) = handle;
+            ladder.markOccupied(price);
+        } else {
+            appendToLevel(ladder, price, handle);
+        }
+        ladder.quantity(price) += order.quantity;
+        ladder.reserve(price) += order.reserveQuantity;
+        ladder.orderCount(price)++;
+        orderIndex.insert(order.orderID, handle);
+        if (order.timeInForce == TimeInForce::DAY) {
+            dayOrderCount++;
+        }
+        
+        bool newBest = false;
+        if (isBuy) {
+            if (buyOrderCount++ == 0 || order.price > bestBid.price) {
+                bestBid.price = order.price;
+                newBest = true;
+            }
+            buyOrderHighWater = max(buyOrderHighWater, buyOrderCount);
+        } else {
+            if (sellOrderCount++ == 0 || order.price < bestAsk.price) {
+                bestAsk.price = order.price;
+                newBest = true;
+            }
+            sellOrderHighWater = max(sellOrderHighWater, sellOrderCount);
+        }
+        refreshTopIfAt(isBuy, order.price);
+        if (newBest) {
+            followMarket();
+        }
+    }
+    
+    void fillOrder(OrderHandle handle, Quantity fillQuantity, uint64_t fillTime) {
+        Order& order = pool[handle];
+        if (fillQuantity >= order.quantity && order.reserveQuantity == 0) {
+            removeOrder(handle);
+            return;
+        }
+        bool isBuy = order.side == Side::Buy;
+        PriceLadder& ladder = ladderOf(isBuy);
+        Price price = order.price;
+        if (fillQuantity < order.quantity) {
+            order.quantity -= fillQuantity;
+            ladder.quantity(price) -= fillQuantity;
+        } else {
+            // Iceberg slice used up: the next one goes to the back of the same level. The
+            // order is relinked in place; it never leaves the level, the index or its slot.
+            ladder.quantity(price) -= order.quantity;
+            showNextSlice(order, fillTime);
+            ladder.quantity(price) += order.quantity;
+            ladder.reserve(price) -= order.quantity;
+            if (ladder.tail(price) != handle) {
+                unlinkFromLevel(ladder, price, handle);
+                appendToLevel(ladder, price, handle);
+            }
+        }
+        refreshTopIfAt(isBuy, price);
+    }
+    
+    // Move an exhausted iceberg slice's successor out of reserve; it queues from time on
+    static void showNextSlice(Order& order, uint64_t time) {
+        order.quantity = min<Quantity>(order.displayQuantity, order.reserveQuantity);
+        order.reserveQuantity -= order.quantity;
+        order.timestamp = time;
+    }
+    
+    // Append an unlinked order to the back of an occupied level's queue
+    void appendToLevel(PriceLadder& ladder, Price price, OrderHandle handle) {
+        pool.linksOf(handle) = OrderLinks{ladder.tail(price), NULL_HANDLE};
+        pool.linksOf(ladder.tail(price)).next = handle;
+        ladder.tail(price) = handle;
+    }
+    
+    // Take an order out of its level's queue, leaving the level's aggregates alone
+    void unlinkFromLevel(PriceLadder& ladder, Price price, OrderHandle handle) {
+        OrderLinks links = pool.linksOf(handle);
+        if (links.prev == NULL_HANDLE) {
+            ladder.head(price) = links.next;
+        } else {
+            pool.linksOf(links.prev).next = links.next;
+        }
+        if (links.next == NULL_HANDLE) {
+            ladder.tail(price) = links.prev;
+        } else {
+            pool.linksOf(links.next).prev = links.prev;
+        }
+    }
+    
+    // Unlink an order from its level and the index and free its slot,
+    // moving the best price on if its level empties
+    void removeOrder(OrderHandle handle) {
+        const Order& order = pool[handle];
+        bool isBuy = order.side == Side::Buy;
+        Price price = order.price;
+        PriceLadder& ladder = ladderOf(isBuy);
+        
+        unlinkFromLevel(ladder, price, handle);
+        ladder.quantity(price) -= order.quantity;
+        ladder.reserve(price) -= order.reserveQuantity;
+        ladder.orderCount(price)--;
+        releaseOrder(handle);
+        bool levelEmptied = ladder.isEmpty(price);
+        if (levelEmptied) {
+            ladder.markEmpty(price);
+        }
+        
+        if (isBuy) {
+            if (--buyOrderCount == 0) {
+                bestBid = TopOfBook();
+                return;
+            } else if (price == bestBid.price && levelEmptied) {
+                bestBid.price = price = ladder.nextBelow(price);
+                refreshTopIfAt(isBuy, price);
+                followMarket();
+                return;
+            }
+        } else {
+            if (--sellOrderCount == 0) {
+                bestAsk = TopOfBook();
+                return;
+            } else if (price == bestAsk.price && levelEmptied) {
+                bestAsk.price = price = ladder.nextAbove(price);
+                refreshTopIfAt(isBuy, price);
+                followMarket();
+                return;
+            }
+        }
+        refreshTopIfAt(isBuy, price);
+    }
+    
+    // Let hybrid-mode ladders keep their dense window centred on the market
+    void followMarket() {
+        Price mid = NO_PRICE;
+        if (buyOrderCount > 0 && sellOrderCount > 0) {
+            mid = bestBid.price + (bestAsk.price - bestBid.price) / 2;
+        } else {
+            mid = buyOrderCount > 0 ? bestBid.price : bestAsk.price;
+        }
+        buyLadder.follow(mid);
+        sellLadder.follow(mid);
+    }
+    
+    // Re-read the cached top of book if the changed level is the one at the touch
+    void refreshTopIfAt(bool isBuy, Price price) {
+        TopOfBook& top = isBuy ? bestBid : bestAsk;
+        if (price == top.price) {
+            const PriceLadder& ladder = ladderOf(isBuy);
+            top.totalQuantity = ladder.quantity(price);
+            top.orderCount = ladder.orderCount(price);
+        }
+    }
+    
+    void displayTopOfBook(const string& label, const TopOfBook& top) const {
+        cout << label << ": ";
+        if (top.orderCount == 0) {
+            cout << "none\n";
+        } else {
+            cout << "$" << instrument.formatPrice(top.price) << " x " << top.totalQuantity
+                 << " (" << top.orderCount << " orders)\n";
+        }
+    }
+    
+    PriceLadder& ladderOf(bool isBuy) { return isBuy ? buyLadder : sellLadder; }
+    const PriceLadder& ladderOf(bool isBuy) const { return isBuy ? buyLadder : sellLadder; }
+    
+    // Next occupied level after price in priority order (lower for bids, higher for asks), or NO_PRICE
+    Price nextLevel(bool isBuy, Price price) const {
+        return isBuy ? buyLadder.nextBelow(price) : sellLadder.nextAbove(price);
+    }
+};
+
+// ================================= StopBook Class =================================
+
+// Stop and stop-limit orders waiting for the market to trade through their stop price.
+// They are keyed by (symbol, stop price) in an ordered map per side, so the stops a range
+// of trade prices sets off are the front of one key range and are found without looking at
+// any other stop. The held order is released as it is: a market order for a plain stop,
+// a limit order for a stop-limit.
+class StopBook {
+private:
+    using Key = uint64_t; // Symbol in the high half, stop rank in the low half
+    using Queue = multimap<Key, Order>; // Equal keys keep arrival order
+    
+    // Buys are set off by prices rising through them, so the lowest stop goes first; sells
+    // by prices falling, so the highest goes first. Ranks make both the smallest key.
+    Queue buyStops;
+    Queue sellStops;
+    unordered_map<int, Queue::iterator> byID; // For cancels; IDs are unique engine-wide
+    
+    static Key key(SymbolId symbol, bool isBuy, Price stopPrice) {
+        uint32_t rank = isBuy ? static_cast<uint32_t>(stopPrice)
+                              : static_cast<uint32_t>(numeric_limits<Price>::max() - stopPrice);
+        return (static_cast<Key>(symbol) << 32) | rank;
+    }
+    
+    static Price stopPriceOf(Key stopKey, bool isBuy) {
+        Price rank = static_cast<Price>(stopKey & 0xFFFFFFFFu);
+        return isBuy ? rank : numeric_limits<Price>::max() - rank;
+    }
+    
+    // First stop of a side set off by trades between low and high; end() if none
+    static Queue::iterator firstTriggered(Queue& stops, SymbolId symbol, bool isBuy, Price low, Price high) {
+        auto first = stops.lower_bound(key(symbol, isBuy, isBuy ? NO_PRICE : numeric_limits<Price>::max()));
+        if (first != stops.end() && first->first <= key(symbol, isBuy, isBuy ? high : low)) {
+            return first;
+        }
+        return stops.end();
+    }
+
+public:
+    // Hold order until stopPrice trades; false if its ID is already held
+    bool add(const Order& order, Price stopPrice) {
+        bool isBuy = order.side == Side::Buy;
+        Queue& stops = isBuy ? buyStops : sellStops;
+        auto inserted = byID.emplace(order.orderID, stops.end());
+        if (!inserted.second) {
+            return false;
+        }
+        inserted.first->second = stops.emplace(key(order.symbol, isBuy, stopPrice), order);
+        return true;
+    }
+    
+    bool cancel(int orderID) {
+        auto found = byID.find(orderID);
+        if (found == byID.end()) {
+            return false;
+        }
+        Order& order = found->second->second;
+        (order.side == Side::Buy ? buyStops : sellStops).erase(found->second);
+        byID.erase(found);
+        return true;
+    }
+    
+    bool contains(int orderID) const { return byID.count(orderID) > 0; }
+    size_t size() const { return byID.size(); }
+    
+    // End of day: drop every waiting DAY stop; returns the count
+    size_t expireDayOrders() {
+        size_t expired = 0;
+        for (Queue* stops : {&buyStops, &sellStops}) {
+            for (auto it = stops->begin(); it != stops->end();) {
+                if (it->second.timeInForce == TimeInForce::DAY) {
+                    byID.erase(it->second.orderID);
+                    it = stops->erase(it);
+                    expired++;
+                } else {
+                    ++it;
+                }
+            }
+        }
+        return expired;
+    }
+    
+    // Take the next stop of symbol set off by trades between low and high: a buy stop at or
+    // below high, or a sell stop at or above low. Each side yields its stops in stop-price
+    // order, then arrival; between the two sides the earlier submitted goes first. O(log n).
+    bool popTriggered(SymbolId symbol, Price low, Price high, Order& order, Price& stopPrice) {
+        auto buy = firstTriggered(buyStops, symbol, true, low, high);
+        auto sell = firstTriggered(sellStops, symbol, false, low, high);
+        if (buy == buyStops.end() && sell == sellStops.end()) {
+            return false;
+        }
+        bool takeBuy = sell == sellStops.end() ||
+                       (buy != buyStops.end() && buy->second.timestamp < sell->second.timestamp);
+        Queue& stops = takeBuy ? buyStops : sellStops;
+        auto next = takeBuy ? buy : sell;
+        order = next->second;
+        stopPrice = stopPriceOf(next->first, takeBuy);
+        byID.erase(order.orderID);
+        stops.erase(next);
+        return true;
+    }
+};
+
+// ================================= MatchingEngine Class =================================
+
+class MatchingEngine {
+private:
+    Arena arena; // Declared first: pool, index and ladders live in it
+    
+    // Resting orders of every symbol share one pool and one ID index, so capacity and
+    // order IDs are engine-wide and a cancel needs only the order ID
+    OrderPool pool;
+    OrderIndex orderIndex;
+    StopBook stops; // Stop orders of every symbol, until their stop price trades
+    TimerWheel timers; // Expiries of resting GTD orders, by pool slot
+    
+    SymbolTable symbols;
+    EngineConfig config;
+    
+    // One book per symbol, indexed by SymbolId. A book (and its ladders) is only built on
+    // the symbol's first resting order, so a symbol that never trades costs one null pointer.
+    vector<unique_ptr<OrderBook>> books;
+    
+    TradeLogger tradeLogger;
+    vector<Trade> pendingTrades; // Fills of the order being matched, reused across orders
+    size_t pendingTradesHighWater = 0;
+    
+    ofstream evictionArchive;    // Open only under EvictionPolicy::Archive
+    uint64_t ordersEvicted = 0;
+    uint64_t ordersArchived = 0;
+    uint64_t ordersExpired = 0;
+    uint64_t capacityRejects = 0;
+    uint64_t nextSequence = 1;
+    
+public:
+    explicit MatchingEngine(const Instrument& instrument = Instrument::defaultInstrument(),
+                            const EngineConfig& engineConfig = EngineConfig())
+        : MatchingEngine(vector<Instrument>{instrument}, engineConfig) {}
+    
+    // Symbols are interned in list order: the first instrument gets SymbolId 0
+    MatchingEngine(const vector<Instrument>& instruments, const EngineConfig& engineConfig)
+        : arena(engineConfig.arenaBytes > 0 ? engineConfig.arenaBytes : defaultArenaBytes(instruments, engineConfig)),
+          pool(engineConfig.maxOrders, arena),
+          orderIndex(engineConfig.maxOrders, arena),
+          timers(engineConfig.maxOrders, arena),
+          config(engineConfig),
+          tradeLogger(engineConfig.tradeLogPath, engineConfig.echo) {
+        if (config.maxOrdersPerSide > 0 && config.evictionPolicy == EvictionPolicy::Archive) {
+            evictionArchive.open(config.archivePath, ios::app);
+        }
+        for (const Instrument& instrument : instruments) {
+            if (symbols.intern(instrument) == NO_SYMBOL) {
+                cout << "Symbol " << instrument.symbol << " ignored: symbol table is full\n";
+            }
+        }
+        books.resize(symbols.size());
+    }
+    
+    const Arena& getArena() const { return arena; }
+    
+    const SymbolTable& getSymbols() const { return symbols; }
+    const Instrument& getInstrument(SymbolId symbol = 0) const { return symbols[symbol]; }
+    
+    // For user input and configuration only; orders already carry their SymbolId
+    SymbolId getSymbolId(const string& symbol) const { return symbols.find(symbol); }
+    
+    // Inside market, kept current by the book as it changes
+    const TopOfBook& getBestBid(SymbolId symbol = 0) const {
+        const OrderBook* book = findBook(symbol);
+        return book == nullptr ? emptyTop() : book->getBestBid();
+    }
+    
+    const TopOfBook& getBestAsk(SymbolId symbol = 0) const {
+        const OrderBook* book = findBook(symbol);
+        return book == nullptr ? emptyTop() : book->getBestAsk();
+    }
+    
+    // A GTD order rests until expiresAt on the engine clock (see advanceClock)
+    void processOrder(const Order& newOrder, EngineTime expiresAt = NO_EXPIRY) {
+        if (!acceptOrder(newOrder, expiresAt)) {
+            return;
+        }
+        
+        // Accepted: stamp with the engine sequence, which defines time priority
+        Order order = newOrder;
+        order.timestamp = nextSequence++;
+        
+        if (config.echo) {
+            cout << "\nProcessing new order:\n";
+            order.display(symbols[order.symbol]);
+        }
+        
+        matchOrder(bookFor(order.symbol), order, expiresAt);
+        releaseStopsAfterMatch(order.symbol);
+    }
+    
+    // Hold an order until its symbol trades at or through stopPrice (at or above it for a
+    // buy, at or below for a sell), then match it as if it had just arrived: a market order
+    // makes a plain stop, a limit order a stop-limit. A stop the last trade has already
+    // passed is released at once.
+    bool submitStopOrder(const Order& newOrder, Price stopPrice) {
+        // Checked first: acceptOrder would otherwise reject it for lacking an expiry
+        if (newOrder.timeInForce == TimeInForce::GTD) {
+            if (config.echo) {
+                cout << "Order rejected: Stop orders cannot be GTD (DAY stops are dropped at the end of day)\n";
+            }
+            return false;
+        }
+        if (!acceptOrder(newOrder, NO_EXPIRY)) {
+            return false;
+        }
+        const Instrument& instrument = symbols[newOrder.symbol];
+        if (!instrument.inPriceBand(stopPrice)) {
+            if (config.echo) {
+                cout << "Order rejected: Stop price outside the allowed band\n";
+            }
+            return false;
+        }
+        
+        Order order = newOrder;
+        order.timestamp = nextSequence++;
+        stops.add(order, stopPrice);
+        if (config.echo) {
+            cout << "\nStop order held until a trade at $" << instrument.formatPrice(stopPrice)
+                 << (order.side == Side::Buy ? " or above:\n" : " or below:\n");
+            order.display(instrument);
+        }
+        
+        const OrderBook* book = findBook(order.symbol);
+        if (book != nullptr && book->getLastTradePrice() != NO_PRICE) {
+            releaseStops(order.symbol, book->getLastTradePrice(), book->getLastTradePrice());
+        }
+        return true;
+    }
+    
+    bool cancelOrder(int orderID) {
+        const Order* existing = findOrder(orderID);
+        if (existing == nullptr) {
+            if (stops.cancel(orderID)) {
+                if (config.echo) {
+                    cout << "Stop order ID " << orderID << " cancelled\n";
+                }
+                return true;
+            }
+            if (config.echo) {
+                cout << "Cancel rejected: Order ID " << orderID << " is not resting in the book\n";
+            }
+            return false;
+        }
+        books[existing->symbol]->cancelOrder(orderID);
+        if (config.echo) {
+            cout << "Order ID " << orderID << " cancelled\n";
+        }
+        return true;
+    }
+    
+    // Engine clock: GTD expiries are measured against it and it moves only when told to
+    EngineTime getTime() const { return timers.getTime(); }
+    
+    // Move the clock forward, removing each GTD order whose expiry has passed as its
+    // timer fires; nothing in the books is scanned
+    void advanceClock(EngineTime time) {
+        timers.advance(time, [this](OrderHandle handle) {
+            const Order& order = pool[handle];
+            int orderID = order.orderID;
+            books[order.symbol]->cancelOrder(orderID);
+            ordersExpired++;
+            if (config.echo) {
+                cout << "Order ID " << orderID << " expired (GTD)\n";
+            }
+        });
+    }
+    
+    // Close the trading day: every DAY order, resting or waiting as a stop, is dropped;
+    // returns the count. Each book drops its DAY orders in one pass over its levels (see
+    // OrderBook::expireDayOrders). When books holding only DAY orders hold at least half of
+    // all resting orders, those books are instead emptied level by level without visiting
+    // their orders; their pool slots are then freed in one sequential pass over the pool, and
+    // the index is rebuilt from the orders that remain. Both passes cost the whole pool, so
+    // they only pay off when most of it is going.
+    size_t endOfDay() {
+        size_t expired = stops.expireDayOrders();
+        size_t dayOnlyOrders = 0;
+        for (const auto& book : books) {
+            if (book && book->onlyDayOrders()) {
+                dayOnlyOrders += book->getDayOrderCount();
+            }
+        }
+        bool bulk = dayOnlyOrders > 0 && dayOnlyOrders * 2 >= pool.size();
+        size_t cleared = 0;
+        for (auto& book : books) {
+            if (book && bulk && book->onlyDayOrders()) {
+                cleared += book->clearLevels();
+            } else if (book) {
+                expired += book->expireDayOrders();
+            }
+        }
+        if (cleared > 0) {
+            // Every DAY order left in the pool belongs to a book that was just cleared
+            orderIndex.clear();
+            pool.releaseIf([&](OrderHandle handle, const Order& order) {
+                if (order.timeInForce == TimeInForce::DAY) {
+                    return true;
+                }
+                orderIndex.insert(order.orderID, handle);
+                return false;
+            });
+            expired += cleared;
+        }
+        ordersExpired += expired;
+        if (config.echo) {
+            cout << "End of day: " << expired << " DAY orders expired\n";
+        }
+        return expired;
+    }
+    
+    // Amend a resting order. A size-down at the same price is applied in place and keeps
+    // time priority; a price change or size-up is a cancel/replace that re-enters matching.
+    // For an iceberg the quantity is its total. The replacement keeps the iceberg peak,
+    // the time in force and any GTD expiry.
+    bool modifyOrder(int orderID, Price newPrice, Quantity newQuantity) {
+        const Order* existing = findOrder(orderID);
+        if (existing == nullptr) {
+            if (config.echo) {
+                cout << "Modify rejected: Order ID " << orderID << " is not resting in the book\n";
+            }
+            return false;
+        }
+        OrderBook& book = *books[existing->symbol];
+        if (!book.getInstrument().inPriceBand(newPrice) || newQuantity == 0) {
+            if (config.echo) {
+                cout << "Modify rejected: Price must be inside the band and quantity positive\n";
+            }
+            return false;
+        }
+        if (newQuantity > 1000) {
+            if (config.echo) {
+                cout << "Modify rejected: Quantity " << newQuantity
+                     << " exceeds maximum allowed (1000)\n";
+            }
+            return false;
+        }
+        
+        if (newPrice == existing->price && newQuantity <= OrderBook::totalQuantity(*existing)) {
+            book.reduceOrderQuantity(orderID, newQuantity);
+            if (config.echo) {
+                cout << "Order ID " << orderID << " reduced to quantity " << newQuantity << "\n";
+            }
+            return true;
+        }
+        
+        Order replacement(orderID, existing->side, newPrice, newQuantity, nextSequence++, existing->symbol);
+        replacement.displayQuantity = existing->displayQuantity;
+        replacement.timeInForce = existing->timeInForce;
+        EngineTime expiresAt = timers.expiryOf(orderIndex.find(orderID));
+        book.cancelOrder(orderID);
+        if (config.echo) {
+            cout << "Order ID " << orderID << " replaced:\n";
+            replacement.display(book.getInstrument());
+        }
+        matchOrder(book, replacement, expiresAt);
+        releaseStopsAfterMatch(replacement.symbol);
+        return true;
+    }
+    
+    // Look up a resting order of any symbol by ID; returns nullptr if it is not resting
+    const Order* findOrder(int orderID) const {
+        OrderHandle handle = orderIndex.find(orderID);
+        return handle == NULL_HANDLE ? nullptr : &pool[handle];
+    }
+    
+    void displayOrderBook(SymbolId symbol = 0) {
+        const OrderBook* book = findBook(symbol);
+        if (book == nullptr) {
+            cout << "\nNo orders have been placed for " << symbols[symbol].symbol << "\n";
+            return;
+        }
+        book->displayOrderBook();
+    }
+    
+    void getDepth(Side side, size_t nLevels, vector<DepthLevel>& depth, SymbolId symbol = 0) const {
+        const OrderBook* book = findBook(symbol);
+        if (book == nullptr) {
+            depth.clear();
+            return;
+        }
+        book->getDepth(side, nLevels, depth);
+    }
+    
+    vector<DepthLevel> getDepth(Side side, size_t nLevels, SymbolId symbol = 0) const {
+        const OrderBook* book = findBook(symbol);
+        return book == nullptr ? vector<DepthLevel>() : book->getDepth(side, nLevels);
+    }
+    
+    void displayDepth(size_t nLevels, SymbolId symbol = 0) {
+        const OrderBook* book = findBook(symbol);
+        if (book == nullptr) {
+            cout << "\nNo orders have been placed for " << symbols[symbol].symbol << "\n";
+            return;
+        }
+        book->displayDepth(nLevels);
+    }
+    
+    uint64_t getLiquidityWithin(Side side, Price ticks, SymbolId symbol = 0) const {
+        const OrderBook* book = findBook(symbol);
+        return book == nullptr ? 0 : book->getLiquidityWithin(side, ticks);
+    }
+    
+    Price getFillPrice(Side incomingSide, uint64_t quantity, SymbolId symbol = 0) const {
+        const OrderBook* book = findBook(symbol);
+        return book == nullptr ? NO_PRICE : book->getFillPrice(incomingSide, quantity);
+    }
+    
+    // Memory and occupancy of every container the engine owns, for capacity planning
+    EngineStats getStats() const {
+        EngineStats stats;
+        stats.arenaBytesReserved = arena.bytesReserved();
+        stats.arenaBytesUsed = arena.bytesUsed();
+        stats.arenaBacking = arena.backingName();
+        stats.orderPool = pool.stats();
+        stats.orderIndex = orderIndex.stats();
+        stats.expiryTimers = timers.stats();
+        stats.tradeBuffer = ContainerStats{pendingTrades.capacity(), pendingTrades.size(), pendingTradesHighWater,
+                                           pendingTrades.capacity() * sizeof(Trade),
+                                           pendingTrades.size() * sizeof(Trade), true};
+        stats.symbols = symbols.size();
+        stats.sideCap = config.maxOrdersPerSide;
+        stats.ordersEvicted = ordersEvicted;
+        stats.ordersArchived = ordersArchived;
+        stats.stopOrders = stops.size();
+        stats.ordersExpired = ordersExpired;
+        stats.capacityRejects = capacityRejects;
+        for (const auto& book : books) {
+            if (book) {
+                stats.books.push_back(book->getStats());
+            }
+        }
+        return stats;
+    }
+    
+    void displayStats() const {
+        EngineStats stats = getStats();
+        cout << "\n========== MEMORY STATS ==========\n";
+        cout << "Arena: " << Utils::formatBytes(stats.arenaBytesUsed) << " used of "
+             << Utils::formatBytes(stats.arenaBytesReserved) << " on " << stats.arenaBacking << "\n";
+        cout << left << setw(22) << "Container" << right << setw(10) << "Used" << setw(12) << "Capacity"
+             << setw(12) << "High-water" << setw(12) << "Bytes used" << setw(12) << "Reserved" << "\n";
+        displayContainer("Order pool", stats.orderPool);
+        displayContainer("Order index", stats.orderIndex);
+        displayContainer("Expiry timers", stats.expiryTimers);
+        displayContainer("Trade buffer", stats.tradeBuffer);
+        for (const BookStats& book : stats.books) {
+            displayContainer(book.symbol + " bid levels", book.bids.levels);
+            if (book.bids.overflowLevels.highWater > 0) {
+                displayContainer(book.symbol + " bid overflow", book.bids.overflowLevels);
+            }
+            displayContainer(book.symbol + " ask levels", book.asks.levels);
+            if (book.asks.overflowLevels.highWater > 0) {
+                displayContainer(book.symbol + " ask overflow", book.asks.overflowLevels);
+            }
+            cout << "  " << book.symbol << " resting orders: " << book.bids.orders << " bids (high-water "
+                 << book.bids.ordersHighWater << "), " << book.asks.orders << " asks (high-water "
+                 << book.asks.ordersHighWater << ")\n";
+        }
+        cout << stats.books.size() << " of " << stats.symbols << " symbols have a book\n";
+        if (stats.stopOrders > 0) {
+            cout << "Stop orders waiting: " << stats.stopOrders << "\n";
+        }
+        if (stats.ordersExpired > 0) {
+            cout << "Orders expired: " << stats.ordersExpired << "\n";
+        }
+        if (stats.capacityRejects > 0) {
+            cout << "Orders cancelled with the pool full: " << stats.capacityRejects << "\n";
+        }
+        if (stats.sideCap > 0) {
+            cout << "Side cap: " << stats.sideCap << " resting orders per side; " << stats.ordersEvicted
+                 << " orders evicted, " << stats.ordersArchived << " archived\n";
+        }
+        cout << "Total reserved by containers: " << Utils::formatBytes(stats.totalBytesReserved()) << "\n";
+        cout << "(* = grows on demand; all other containers are fixed at startup)\n";
+        cout << "==================================\n\n";
+    }
+    
+    // Read-only access for views and snapshots (see OrderBook::orders); nullptr until
+    // the symbol has had an order
+    const OrderBook* getOrderBook(SymbolId symbol = 0) const { return findBook(symbol); }
+    
+    void generateRandomOrders(int count) {
+        cout << "\nGenerating " << count << " random orders...\n";
+        static int orderCounter = 10000; // Start from 10000 for random orders
+        
+        for (int i = 0; i < count; i++) {
+            Order randomOrder = Utils::generateRandomOrder(orderCounter++, symbols);
+            processOrder(randomOrder);
+        }
+    }
+    
+private:
+    // Default arena: the shared pool, index and timers plus the ladders of every symbol, so
+    // a book created on its symbol's first order still lands in pre-faulted memory. With an
+    // explicitly sized arena, books that no longer fit fall back to the heap.
+    static size_t defaultArenaBytes(const vector<Instrument>& instruments, const EngineConfig& config) {
+        size_t bytes = OrderPool::arenaBytes(config.maxOrders) + OrderIndex::arenaBytes(config.maxOrders) +
+                       TimerWheel::arenaBytes(config.maxOrders);
+        for (const Instrument& instrument : instruments) {
+            bytes += OrderBook::arenaBytes(instrument, config);
+        }
+        return bytes;
+    }
+    
+    static void displayContainer(const string& name, const ContainerStats& stats) {
+        cout << left << setw(22) << (stats.growable ? name + " *" : name) << right << setw(10) << stats.used
+             << setw(12) << stats.capacity << setw(12) << stats.highWater
+             << setw(12) << Utils::formatBytes(stats.bytesUsed) << setw(12) << Utils::formatBytes(stats.bytesReserved)
+             << "\n";
+    }
+    
+    static const TopOfBook& emptyTop() {
+        static const TopOfBook empty;
+        return empty;
+    }
+    
+    const OrderBook* findBook(SymbolId symbol) const {
+        return symbols.contains(symbol) ? books[symbol].get() : nullptr;
+    }
+    
+    OrderBook& bookFor(SymbolId symbol) {
+        if (!books[symbol]) {
+            books[symbol] = make_unique<OrderBook>(symbols[symbol], symbol, config, pool, orderIndex, timers, arena);
+        }
+        return *books[symbol];
+    }
+    
+    // Side cap: before an order rests on a full side, evict that side's lowest-priority order.
+    // If the newcomer would rank last itself, it is the one evicted and false is returned.
+    template <Side S>
+    bool makeRoom(OrderBook& book, const Order& order) {
+        if (config.maxOrdersPerSide == 0 || book.getOrderCount<S>() < config.maxOrdersPerSide) {
+            return true;
+        }
+        const Order* worst = book.worstOrder<S>();
+        bool newcomerRanksLast = S == Side::Buy ? order.price <= worst->price : order.price >= worst->price;
+        if (newcomerRanksLast) {
+            evict(book.getInstrument(), order);
+            return false;
+        }
+        Order evicted = *worst;
+        book.cancelOrder(evicted.orderID);
+        evict(book.getInstrument(), evicted);
+        return true;
+    }
+    
+    void evict(const Instrument& instrument, const Order& order) {
+        ordersEvicted++;
+        bool archived = evictionArchive.is_open();
+        if (archived) {
+            // Buffered; the stream is flushed when the engine shuts down
+            evictionArchive << instrument.symbol << " Order ID: " << order.orderID << ", Type: "
+                            << sideToString(order.side) << ", Price: $" << instrument.formatPrice(order.price)
+                            << ", Quantity: " << order.quantity << ", Timestamp: " << order.timestamp << "\n";
+            ordersArchived++;
+        }
+        if (config.echo) {
+            cout << "Order ID " << order.orderID << " evicted: " << instrument.symbol << " "
+                 << sideToString(order.side) << " side is at its cap of " << config.maxOrdersPerSide
+                 << " orders" << (archived ? " (archived)" : "") << "\n";
+        }
+    }
+    
+    void reportCapacityReject(const Order& order) {
+        capacityRejects++;
+        if (config.echo) {
+            cout << "Order ID " << order.orderID << ": remaining quantity " << order.quantity
+                 << " cancelled, order book is at capacity (" << pool.capacity() << " resting orders)\n";
+        }
+    }
     
-    void display() const {
-        cout << "Order ID: " << orderID << ", Type: " << type 
-             << ", Price: $" << price << ", Quantity: " << quantity 
-             << ", Timestamp: " << timestamp << endl;
+    // Order checks shared by every way in; prints the reason and returns false on a reject
+    bool acceptOrder(const Order& newOrder, EngineTime expiresAt) const {
+        // Orders must name a registered instrument
+        if (!symbols.contains(newOrder.symbol)) {
+            if (config.echo) {
+                cout << "Order rejected: Unknown symbol ID " << newOrder.symbol << "\n";
+            }
+            return false;
+        }
+        
+        // Risk check: don't allow orders over 1000 quantity
+        if (newOrder.quantity > 1000) {
+            if (config.echo) {
+                cout << "Order rejected: Quantity " << newOrder.quantity 
+                     << " exceeds maximum allowed (1000)\n";
+            }
+            return false;
+        }
+        
+        // Risk check: price must fall inside the instrument's price band (market orders have none)
+        const Instrument& instrument = symbols[newOrder.symbol];
+        if (newOrder.type == OrderType::Limit && !instrument.inPriceBand(newOrder.price)) {
+            if (config.echo) {
+                cout << "Order rejected: Price outside the allowed band\n";
+            }
+            return false;
+        }
+        
+        // Only a resting order has anything to hide
+        if (newOrder.isIceberg() && newOrder.type == OrderType::Market) {
+            if (config.echo) {
+                cout << "Order rejected: Market orders cannot be icebergs\n";
+            }
+            return false;
+        }
+        
+        if (newOrder.timeInForce == TimeInForce::GTD && (expiresAt == NO_EXPIRY || expiresAt <= timers.getTime())) {
+            if (config.echo) {
+                cout << "Order rejected: GTD orders need an expiry time after the engine clock\n";
+            }
+            return false;
+        }
+        
+        // Order IDs must be unique among resting orders so cancels reach the right one
+        if (orderIndex.find(newOrder.orderID) != NULL_HANDLE) {
+            if (config.echo) {
+                cout << "Order rejected: Order ID " << newOrder.orderID
+                     << " is already resting in the book\n";
+            }
+            return false;
+        }
+        if (stops.contains(newOrder.orderID)) {
+            if (config.echo) {
+                cout << "Order rejected: Order ID " << newOrder.orderID
+                     << " is already held as a stop order\n";
+            }
+            return false;
+        }
+        return true;
     }
-};
-
-// ================================= Order Comparators =================================
-
-// Comparator for buy orders (max-heap by price, then by timestamp for same price)
-struct BuyOrderComparator {
-    bool operator()(const Order& a, const Order& b) const {
-        if (a.price != b.price) {
-            return a.price < b.price; // Max-heap: higher price has priority
+    
+    // Release the stops set off by the fills of the order just matched
+    void releaseStopsAfterMatch(SymbolId symbol) {
+        if (pendingTrades.empty() || stops.size() == 0) {
+            return;
         }
-        return a.timestamp > b.timestamp; // Earlier timestamp has priority
+        // A sweep's fills run from the best price to the worst, so the ends bound them
+        Price first = pendingTrades.front().price, last = pendingTrades.back().price;
+        releaseStops(symbol, min(first, last), max(first, last));
     }
-};
-
-// Comparator for sell orders (min-heap by price, then by timestamp for same price)
-struct SellOrderComparator {
-    bool operator()(const Order& a, const Order& b) const {
-        if (a.price != b.price) {
-            return a.price > b.price; // Min-heap: lower price has priority
+    
+    // Run a stop cascade to the end, one stop per step: each step takes the next stop set
+    // off by the prices traded so far (one ordered lookup), matches it as a new order and
+    // widens the traded range by its fills. Iterative, so a long cascade never deepens the
+    // stack, and a step costs the same however many stops are waiting.
+    void releaseStops(SymbolId symbol, Price low, Price high) {
+        OrderBook& book = bookFor(symbol);
+        Order order;
+        Price stopPrice = NO_PRICE;
+        while (stops.popTriggered(symbol, low, high, order, stopPrice)) {
+            order.timestamp = nextSequence++;
+            if (config.echo) {
+                cout << "\nStop order ID " << order.orderID << " triggered (stop $"
+                     << book.getInstrument().formatPrice(stopPrice) << "):\n";
+                order.display(book.getInstrument());
+            }
+            matchOrder(book, order);
+            if (!pendingTrades.empty()) {
+                Price first = pendingTrades.front().price, last = pendingTrades.back().price;
+                low = min(low, min(first, last));
+                high = max(high, max(first, last));
+            }
         }
-        return a.timestamp > b.timestamp; // Earlier timestamp has priority
     }
-};
-
-// ================================= Utils Class =================================
-
-class Utils {
-public:
-    static long getCurrentTimestamp() {
-        return chrono::duration_cast<chrono::milliseconds>(
-            chrono::system_clock::now().time_since_epoch()
-        ).count();
+    
+    // Route an accepted order to the matching core; this is the only runtime side branch
+    void matchOrder(OrderBook& book, const Order& order, EngineTime expiresAt = NO_EXPIRY) {
+        if (order.side == Side::Buy) {
+            matchOrder<Side::Buy>(book, order, expiresAt);
+        } else {
+            matchOrder<Side::Sell>(book, order, expiresAt);
+        }
     }
     
-    static Order generateRandomOrder(int orderID) {
-        static random_device rd;
-        static mt19937 gen(rd());
-        static uniform_int_distribution<> typeDist(0, 1);
-        static uniform_real_distribution<> priceDist(50.0, 150.0);
-        static uniform_int_distribution<> quantityDist(10, 500);
+    template <Side S>
+    void matchOrder(OrderBook& book, const Order& incomingOrder, EngineTime expiresAt) {
+        constexpr Side opposite = SideTraits<S>::opposite;
+        Order order = incomingOrder;
+        bool isMarket = order.type == OrderType::Market;
+        pendingTrades.clear();
+        if (isMarket) {
+            // Bounded only by the price band, so every resting level on the other side crosses
+            order.price = S == Side::Buy ? book.getInstrument().maxPrice : NO_PRICE + 1;
+        }
+        
+        // Fill or kill: the level aggregates must hold enough crossing size before anything
+        // trades. Iceberg reserve counts, since the sweep keeps filling its slices.
+        if (order.timeInForce == TimeInForce::FOK) {
+            Price fillPrice = book.getFillPrice(S, order.quantity, true);
+            if (fillPrice == NO_PRICE || !SideTraits<S>::crosses(order.price, fillPrice)) {
+                if (config.echo) {
+                    cout << "Order ID " << order.orderID << " killed: quantity " << order.quantity
+                         << " cannot be filled in full\n";
+                }
+                return;
+            }
+        }
+        
+        // Sweep the opposite side at the resting orders' prices, then report all fills at once
+        order.quantity = book.sweep<opposite>(order, pendingTrades);
+        pendingTradesHighWater = max(pendingTradesHighWater, pendingTrades.size());
+        if (!pendingTrades.empty()) {
+            tradeLogger.logTrades(book.getInstrument(), pendingTrades);
+        }
+        
+        // Market orders never rest: whatever the book could not fill is cancelled
+        if (isMarket) {
+            if (order.quantity > 0 && config.echo) {
+                cout << "Order ID " << order.orderID << ": remaining quantity " << order.quantity
+                     << " cancelled, no more " << sideToString(opposite) << " orders to fill against\n";
+            }
+            return;
+        }
         
-        string type = (typeDist(gen) == 0) ? "buy" : "sell";
-        double price = round(priceDist(gen) * 100.0) / 100.0; // Round to 2 decimal places
-        int quantity = quantityDist(gen);
-        long timestamp = getCurrentTimestamp();
+        // Immediate-or-cancel orders drop their remainder (a passed FOK check leaves none)
+        if (order.timeInForce == TimeInForce::IOC || order.timeInForce == TimeInForce::FOK) {
+            if (order.quantity > 0 && config.echo) {
+                cout << "Order ID " << order.orderID << ": remaining quantity " << order.quantity
+                     << " cancelled (" << timeInForceToString(order.timeInForce) << ")\n";
+            }
+            return;
+        }
         
-        return Order(orderID, type, price, quantity, timestamp);
+        // If there's remaining quantity, add to order book (its storage is preallocated and never grows)
+        if (order.quantity > 0 && makeRoom<S>(book, order)) {
+            if (pool.isFull()) {
+                reportCapacityReject(order);
+                return;
+            }
+            if constexpr (S == Side::Buy) {
+                book.addBuyOrder(order);
+            } else {
+                book.addSellOrder(order);
+            }
+            if (order.timeInForce == TimeInForce::GTD) {
+                timers.schedule(orderIndex.find(order.orderID), expiresAt);
+            }
+        }
     }
 };
 
-// ================================= TradeLogger Class =================================
+// ================================= SpscQueue Class =================================
 
-class TradeLogger {
+// Bounded single-producer / single-consumer ring. The producer only writes tail and the
+// consumer only writes head, each on its own cache line, so a push or pop is a plain
+// copy plus one release store; each side re-reads the other's index only when the ring
+// looks full (or empty) from its cached copy.
+template <typename T>
+class SpscQueue {
 private:
-    ofstream logFile;
+    vector<T> slots;
+    size_t mask;
+    
+    alignas(64) atomic<size_t> head{0}; // Next slot to pop; written by the consumer
+    size_t cachedTail = 0;              // Consumer's last view of tail
     
+    alignas(64) atomic<size_t> tail{0}; // Next slot to push; written by the producer
+    size_t cachedHead = 0;              // Producer's last view of head
+    size_t highWater = 0;               // Deepest backlog seen by the producer (an upper bound)
+
 public:
-    TradeLogger(const string& filename = "trades.log") {
-        logFile.open(filename, ios::app);
-        if (logFile.is_open()) {
-            logFile << "\n========== Trading Session Started at " 
-                    << getCurrentTimeString() << " ==========\n";
+    explicit SpscQueue(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity) {
+            size <<= 1;
         }
+        slots.resize(size);
+        mask = size - 1;
     }
     
-    ~TradeLogger() {
-        if (logFile.is_open()) {
-            logFile << "========== Trading Session Ended at " 
-                    << getCurrentTimeString() << " ==========\n\n";
-            logFile.close();
+    // Producer side; returns false when the ring is full
+    bool tryPush(const T& item) {
+        size_t position = tail.load(memory_order_relaxed);
+        if (position - cachedHead == slots.size()) {
+            cachedHead = head.load(memory_order_acquire);
+            if (position - cachedHead == slots.size()) {
+                return false;
+            }
         }
+        slots[position & mask] = item;
+        tail.store(position + 1, memory_order_release);
+        highWater = max(highWater, position + 1 - cachedHead);
+        return true;
     }
     
-    void logTrade(int buyOrderID, int sellOrderID, double price, int quantity) {
-        string tradeMsg = "Trade executed: BuyOrderID " + to_string(buyOrderID) +
-                          " SellOrderID " + to_string(sellOrderID) +
-                          " at price $" + to_string(price) +
-                          " for quantity " + to_string(quantity);
-        
-        // Print to console
-        cout << tradeMsg << endl;
-        
-        // Log to file
-        if (logFile.is_open()) {
-            logFile << getCurrentTimeString() << " - " << tradeMsg << endl;
-            logFile.flush();
-        }
+    // Producer side: current backlog and the deepest seen
+    ContainerStats stats() const {
+        size_t depth = tail.load(memory_order_relaxed) - head.load(memory_order_acquire);
+        return ContainerStats{slots.size(), depth, highWater, slots.size() * sizeof(T), depth * sizeof(T), false};
     }
     
-private:
-    string getCurrentTimeString() {
-        auto now = time(nullptr);
-        auto tm = *localtime(&now);
-        ostringstream oss;
-        oss << put_time(&tm, "%Y-%m-%d %H:%M:%S");
-        return oss.str();
+    // Consumer side; returns false when the ring is empty
+    bool tryPop(T& item) {
+        size_t position = head.load(memory_order_relaxed);
+        if (position == cachedTail) {
+            cachedTail = tail.load(memory_order_acquire);
+            if (position == cachedTail) {
+                return false;
+            }
+        }
+        item = slots[position & mask];
+        head.store(position + 1, memory_order_release);
+        return true;
     }
 };
 
-// ================================= OrderBook Class =================================
+// ================================= ShardedEngine Class =================================
 
-class OrderBook {
+// Work handed from the dispatcher to a shard: the order carries the shard-local SymbolId
+struct ShardCommand {
+    enum class Type : uint8_t { Submit, SubmitStop, Cancel, Modify, AdvanceClock, EndOfDay, Stop };
+    
+    Type type = Type::Stop;
+    Order order{}; // Cancel uses orderID; Modify uses orderID, price and quantity
+    Price stopPrice = NO_PRICE; // SubmitStop only
+    EngineTime time = NO_EXPIRY; // Submit: GTD expiry; AdvanceClock: the new engine time
+};
+
+// Symbols partitioned across worker threads. Each shard is a complete MatchingEngine over
+// its own symbols (books, order pool, arena, trade log and sequence counter) driven by one
+// thread, so shards share no mutable state and never lock; the only cross-thread traffic is
+// each shard's inbound queue. Symbol s goes to shard s % N as local symbol s / N.
+//
+// Orders, cancels and modifies are submitted from a single dispatcher thread. Per-shard
+// results (books, depth) may be read through shard() once drain() has returned.
+class ShardedEngine {
 private:
-    priority_queue<Order, vector<Order>, BuyOrderComparator> buyOrders;
-    priority_queue<Order, vector<Order>, SellOrderComparator> sellOrders;
+    struct Shard {
+        MatchingEngine engine;
+        SpscQueue<ShardCommand> queue;
+        uint64_t submitted = 0;                 // Dispatcher-only
+        alignas(64) atomic<uint64_t> completed{0};
+        thread worker;
+        
+        Shard(const vector<Instrument>& instruments, const EngineConfig& config, size_t queueCapacity)
+            : engine(instruments, config), queue(queueCapacity) {}
+    };
+    
+    SymbolTable symbols; // Engine-wide IDs, as seen by callers
+    vector<unique_ptr<Shard>> shards;
 
 public:
-    void addBuyOrder(const Order& order) {
-        buyOrders.push(order);
+    static constexpr size_t QUEUE_CAPACITY = 65536; // Commands in flight per shard
+    
+    // Each shard gets the full config, so maxOrders and the arena are per shard. Shards
+    // run quietly and log trades to trades.shard<N>.log.
+    ShardedEngine(const vector<Instrument>& instruments, size_t shardCount, const EngineConfig& config) {
+        for (const Instrument& instrument : instruments) {
+            symbols.intern(instrument);
+        }
+        shardCount = max<size_t>(1, min(shardCount, symbols.size()));
+        
+        for (size_t index = 0; index < shardCount; index++) {
+            vector<Instrument> owned;
+            for (size_t symbol = index; symbol < symbols.size(); symbol += shardCount) {
+                owned.push_back(symbols[static_cast<SymbolId>(symbol)]);
+            }
+            EngineConfig shardConfig = config;
+            shardConfig.tradeLogPath = "trades.shard" + to_string(index) + ".log";
+            shardConfig.echo = false;
+            shardConfig.archivePath = "evicted_orders.shard" + to_string(index) + ".log";
+            shards.push_back(make_unique<Shard>(owned, shardConfig, QUEUE_CAPACITY));
+        }
+        for (auto& shard : shards) {
+            Shard* owner = shard.get();
+            shard->worker = thread([owner]() { run(*owner); });
+        }
     }
     
-    void addSellOrder(const Order& order) {
-        sellOrders.push(order);
+    ~ShardedEngine() {
+        for (auto& shard : shards) {
+            push(*shard, ShardCommand{ShardCommand::Type::Stop, Order{}});
+        }
+        for (auto& shard : shards) {
+            shard->worker.join();
+        }
     }
     
-    bool hasBuyOrders() const {
-        return !buyOrders.empty();
+    ShardedEngine(const ShardedEngine&) = delete;
+    ShardedEngine& operator=(const ShardedEngine&) = delete;
+    
+    const SymbolTable& getSymbols() const { return symbols; }
+    size_t shardCount() const { return shards.size(); }
+    size_t shardOf(SymbolId symbol) const { return symbol % shards.size(); }
+    SymbolId localSymbol(SymbolId symbol) const { return static_cast<SymbolId>(symbol / shards.size()); }
+    
+    // Only safe to read between drain() and the next submission
+    const MatchingEngine& shard(size_t index) const { return shards[index]->engine; }
+    
+    // Inbound queue of one shard; call from the dispatcher thread
+    ContainerStats getQueueStats(size_t index) const { return shards[index]->queue.stats(); }
+    
+    // Route an order to its symbol's shard; order.symbol is the engine-wide SymbolId
+    bool submitOrder(const Order& order, EngineTime expiresAt = NO_EXPIRY) {
+        if (!symbols.contains(order.symbol)) {
+            cout << "Order rejected: Unknown symbol ID " << order.symbol << "\n";
+            return false;
+        }
+        ShardCommand command{ShardCommand::Type::Submit, order, NO_PRICE, expiresAt};
+        command.order.symbol = localSymbol(order.symbol);
+        push(*shards[shardOf(order.symbol)], command);
+        return true;
     }
     
-    bool hasSellOrders() const {
-        return !sellOrders.empty();
+    bool submitStopOrder(const Order& order, Price stopPrice) {
+        if (!symbols.contains(order.symbol)) {
+            cout << "Order rejected: Unknown symbol ID " << order.symbol << "\n";
+            return false;
+        }
+        ShardCommand command{ShardCommand::Type::SubmitStop, order, stopPrice};
+        command.order.symbol = localSymbol(order.symbol);
+        push(*shards[shardOf(order.symbol)], command);
+        return true;
     }
     
-    Order getTopBuyOrder() {
-        Order order = buyOrders.top();
-        buyOrders.pop();
-        return order;
+    // Order IDs are unique per shard, so cancels and modifies name the symbol for routing
+    bool cancelOrder(SymbolId symbol, int orderID) {
+        return route(ShardCommand::Type::Cancel, Order(orderID, Side::Buy, NO_PRICE, 0, 0, symbol));
     }
     
-    Order getTopSellOrder() {
-        Order order = sellOrders.top();
-        sellOrders.pop();
-        return order;
+    bool modifyOrder(SymbolId symbol, int orderID, Price newPrice, Quantity newQuantity) {
+        return route(ShardCommand::Type::Modify, Order(orderID, Side::Buy, newPrice, newQuantity, 0, symbol));
     }
     
-    Order peekTopBuyOrder() const {
-        return buyOrders.top();
+    // Every shard keeps its own clock; these move them all, in order with the orders before
+    void advanceClock(EngineTime time) {
+        ShardCommand command{ShardCommand::Type::AdvanceClock, Order{}, NO_PRICE, time};
+        for (auto& shard : shards) {
+            push(*shard, command);
+        }
     }
     
-    Order peekTopSellOrder() const {
-        return sellOrders.top();
+    void endOfDay() {
+        for (auto& shard : shards) {
+            push(*shard, ShardCommand{ShardCommand::Type::EndOfDay, Order{}});
+        }
     }
     
-    void displayOrderBook() const {
-        cout << "\n========== ORDER BOOK ==========\n";
-        
-        // Display buy orders (we need to copy the queue to display without modifying)
-        cout << "BUY ORDERS (Highest price first):\n";
-        if (buyOrders.empty()) {
-            cout << "  No buy orders\n";
-        } else {
-            auto tempBuyQueue = buyOrders;
-            int count = 0;
-            while (!tempBuyQueue.empty() && count < 5) { // Show top 5
-                Order order = tempBuyQueue.top();
-                tempBuyQueue.pop();
-                cout << "  ";
-                order.display();
-                count++;
-            }
-            if (buyOrders.size() > 5) {
-                cout << "  ... and " << (buyOrders.size() - 5) << " more buy orders\n";
+    // Wait until every shard has processed everything submitted so far
+    void drain() const {
+        for (const auto& shard : shards) {
+            while (shard->completed.load(memory_order_acquire) < shard->submitted) {
+                this_thread::yield();
             }
         }
-        
-        cout << "\nSELL ORDERS (Lowest price first):\n";
-        if (sellOrders.empty()) {
-            cout << "  No sell orders\n";
-        } else {
-            auto tempSellQueue = sellOrders;
-            int count = 0;
-            while (!tempSellQueue.empty() && count < 5) { // Show top 5
-                Order order = tempSellQueue.top();
-                tempSellQueue.pop();
-                cout << "  ";
-                order.display();
-                count++;
+    }
+
+private:
+    bool route(ShardCommand::Type type, const Order& order) {
+        if (!symbols.contains(order.symbol)) {
+            return false;
+        }
+        ShardCommand command{type, order};
+        command.order.symbol = localSymbol(order.symbol);
+        push(*shards[shardOf(order.symbol)], command);
+        return true;
+    }
+    
+    static void push(Shard& shard, const ShardCommand& command) {
+        while (!shard.queue.tryPush(command)) {
+            this_thread::yield(); // Shard is behind; back-pressure the dispatcher
+        }
+        shard.submitted++;
+    }
+    
+    // Worker loop: the shard's engine is touched by this thread only
+    static void run(Shard& shard) {
+        ShardCommand command;
+        size_t idleSpins = 0;
+        while (true) {
+            if (!shard.queue.tryPop(command)) {
+                if (++idleSpins > 1000) {
+                    this_thread::yield();
+                }
+                continue;
             }
-            if (sellOrders.size() > 5) {
-                cout << "  ... and " << (sellOrders.size() - 5) << " more sell orders\n";
+            idleSpins = 0;
+            
+            const Order& order = command.order;
+            switch (command.type) {
+                case ShardCommand::Type::Submit:
+                    shard.engine.processOrder(order, command.time);
+                    break;
+                case ShardCommand::Type::SubmitStop:
+                    shard.engine.submitStopOrder(order, command.stopPrice);
+                    break;
+                case ShardCommand::Type::Cancel:
+                    shard.engine.cancelOrder(order.orderID);
+                    break;
+                case ShardCommand::Type::Modify:
+                    shard.engine.modifyOrder(order.orderID, order.price, order.quantity);
+                    break;
+                case ShardCommand::Type::AdvanceClock:
+                    shard.engine.advanceClock(command.time);
+                    break;
+                case ShardCommand::Type::EndOfDay:
+                    shard.engine.endOfDay();
+                    break;
+                case ShardCommand::Type::Stop:
+                    shard.completed.fetch_add(1, memory_order_release);
+                    return;
             }
+            shard.completed.fetch_add(1, memory_order_release);
         }
-        cout << "===============================\n\n";
     }
-    
-    size_t getBuyOrderCount() const { return buyOrders.size(); }
-    size_t getSellOrderCount() const { return sellOrders.size(); }
 };
 
-// ================================= MatchingEngine Class =================================
+// ================================= Main Function =================================
 
-class MatchingEngine {
-private:
-    OrderBook orderBook;
-    TradeLogger tradeLogger;
-    
-public:
-    MatchingEngine() : tradeLogger("trades.log") {}
-    
-    void processOrder(const Order& newOrder) {
-        // Risk check: don't allow orders over 1000 quantity
-        if (newOrder.quantity > 1000) {
-            cout << "Order rejected: Quantity " << newOrder.quantity 
-                 << " exceeds maximum allowed (1000)\n";
-            return;
-        }
-        
-        cout << "\nProcessing new order:\n";
-        newOrder.display();
-        
-        if (newOrder.type == "buy") {
-            processBuyOrder(newOrder);
-        } else {
-            processSellOrder(newOrder);
-        }
+// Ask which instrument to act on; with a single instrument there is nothing to ask
+static bool readSymbol(const MatchingEngine& engine, SymbolId& symbol) {
+    if (engine.getSymbols().size() == 1) {
+        symbol = 0;
+        return true;
+    }
+    string name;
+    cout << "Enter symbol: ";
+    cin >> name;
+    symbol = engine.getSymbolId(name);
+    if (symbol == NO_SYMBOL) {
+        cout << "Unknown symbol! Start the engine with --symbols to trade more instruments.\n";
+        return false;
     }
+    return true;
+}
+
+// Non-interactive load run: random orders over every symbol, dispatched to the shards
+static void runSimulation(const vector<Instrument>& instruments, const EngineConfig& config,
+                          size_t shardCount, size_t orderCount) {
+    ShardedEngine engine(instruments, shardCount, config);
     
-    void displayOrderBook() {
-        orderBook.displayOrderBook();
+    // Generate up front so the timed section is dispatch and matching only
+    vector<Order> orders;
+    orders.reserve(orderCount);
+    for (size_t i = 0; i < orderCount; i++) {
+        orders.push_back(Utils::generateRandomOrder(static_cast<int>(i + 1), engine.getSymbols()));
     }
     
-    void generateRandomOrders(int count) {
-        cout << "\nGenerating " << count << " random orders...\n";
-        static int orderCounter = 10000; // Start from 10000 for random orders
-        
-        for (int i = 0; i < count; i++) {
-            Order randomOrder = Utils::generateRandomOrder(orderCounter++);
-            processOrder(randomOrder);
-        }
+    cout << "Simulating " << orderCount << " orders over " << engine.getSymbols().size()
+         << " symbols on " << engine.shardCount() << " shard(s)...\n";
+    auto start = chrono::steady_clock::now();
+    for (const Order& order : orders) {
+        engine.submitOrder(order);
     }
+    engine.drain();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
     
-private:
-    void processBuyOrder(Order buyOrder) {
-        // Try to match with existing sell orders
-        while (buyOrder.quantity > 0 && orderBook.hasSellOrders()) {
-            Order topSellOrder = orderBook.peekTopSellOrder();
-            
-            // Check if prices match (buy price >= sell price)
-            if (buyOrder.price >= topSellOrder.price) {
-                // Remove the sell order from the book
-                orderBook.getTopSellOrder();
-                
-                // Execute trade
-                int tradeQuantity = min(buyOrder.quantity, topSellOrder.quantity);
-                double tradePrice = topSellOrder.price; // Use the sell order's price
-                
-                tradeLogger.logTrade(buyOrder.orderID, topSellOrder.orderID, tradePrice, tradeQuantity);
-                
-                // Update quantities
-                buyOrder.quantity -= tradeQuantity;
-                topSellOrder.quantity -= tradeQuantity;
-                
-                // If sell order still has quantity, put it back in the book
-                if (topSellOrder.quantity > 0) {
-                    orderBook.addSellOrder(topSellOrder);
-                }
-            } else {
-                // No match possible, break the loop
-                break;
-            }
+    cout << fixed << setprecision(3) << "Processed in " << seconds << " s ("
+         << setprecision(0) << orderCount / seconds << " orders/s)\n";
+    for (size_t index = 0; index < engine.shardCount(); index++) {
+        EngineStats stats = engine.shard(index).getStats();
+        ContainerStats queue = engine.getQueueStats(index);
+        cout << "Shard " << index << ": " << stats.books.size() << " books, " << stats.orderPool.used
+             << " resting orders (high-water " << stats.orderPool.highWater << " of " << stats.orderPool.capacity
+             << "), queue high-water " << queue.highWater << " of " << queue.capacity << ", "
+             << Utils::formatBytes(stats.totalBytesReserved()) << " reserved";
+        if (stats.sideCap > 0) {
+            cout << ", " << stats.ordersEvicted << " evicted by the side cap";
         }
-        
-        // If there's remaining quantity, add to order book
-        if (buyOrder.quantity > 0) {
-            orderBook.addBuyOrder(buyOrder);
+        if (stats.capacityRejects > 0) {
+            cout << ", " << stats.capacityRejects << " cancelled with the pool full";
         }
+        cout << "\n";
     }
-    
-    void processSellOrder(Order sellOrder) {
-        // Try to match with existing buy orders
-        while (sellOrder.quantity > 0 && orderBook.hasBuyOrders()) {
-            Order topBuyOrder = orderBook.peekTopBuyOrder();
-            
-            // Check if prices match (sell price <= buy price)
-            if (sellOrder.price <= topBuyOrder.price) {
-                // Remove the buy order from the book
-                orderBook.getTopBuyOrder();
-                
-                // Execute trade
-                int tradeQuantity = min(sellOrder.quantity, topBuyOrder.quantity);
-                double tradePrice = topBuyOrder.price; // Use the buy order's price
-                
-                tradeLogger.logTrade(topBuyOrder.orderID, sellOrder.orderID, tradePrice, tradeQuantity);
-                
-                // Update quantities
-                sellOrder.quantity -= tradeQuantity;
-                topBuyOrder.quantity -= tradeQuantity;
-                
-                // If buy order still has quantity, put it back in the book
-                if (topBuyOrder.quantity > 0) {
-                    orderBook.addBuyOrder(topBuyOrder);
+    cout << "Trades were logged to trades.shard0.log";
+    if (engine.shardCount() > 1) {
+        cout << " .. trades.shard" << engine.shardCount() - 1 << ".log";
+    }
+    cout << "\n";
+}
+
+int main(int argc, char* argv[]) {
+    EngineConfig config;
+    vector<Instrument> instruments;
+    size_t shardCount = 1;
+    size_t simulateCount = 0;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        string value = i + 1 < argc ? argv[i + 1] : "";
+        if (arg == "--max-orders" && Utils::parseCount(value, config.maxOrders)) {
+            i++;
+        } else if (arg == "--book-mode" && (value == "dense" || value == "hybrid")) {
+            config.bookMode = value == "dense" ? BookMode::Dense : BookMode::Hybrid;
+            i++;
+        } else if (arg == "--ring-levels" && Utils::parseCount(value, config.ringLevels)) {
+            i++;
+        } else if (arg == "--arena-size" && Utils::parseCount(value, config.arenaBytes)) {
+            i++;
+        } else if (arg == "--symbols" && !value.empty()) {
+            // Comma-separated list; each symbol trades on the default instrument's tick and band
+            stringstream list(value);
+            string symbol;
+            while (getline(list, symbol, ',')) {
+                if (!symbol.empty()) {
+                    Instrument instrument = Instrument::defaultInstrument();
+                    instrument.symbol = symbol;
+                    instruments.push_back(instrument);
                 }
-            } else {
-                // No match possible, break the loop
-                break;
             }
-        }
-        
-        // If there's remaining quantity, add to order book
-        if (sellOrder.quantity > 0) {
-            orderBook.addSellOrder(sellOrder);
+            i++;
+        } else if (arg == "--side-cap" && Utils::parseCount(value, config.maxOrdersPerSide)) {
+            i++;
+        } else if (arg == "--evict" && (value == "drop" || value == "archive")) {
+            config.evictionPolicy = value == "drop" ? EvictionPolicy::Drop : EvictionPolicy::Archive;
+            i++;
+        } else if (arg == "--shards" && Utils::parseCount(value, shardCount)) {
+            i++;
+        } else if (arg == "--simulate" && Utils::parseCount(value, simulateCount)) {
+            i++;
+        } else {
+            cout << "Usage: " << argv[0]
+                 << " [--max-orders N] [--book-mode dense|hybrid] [--ring-levels N] [--arena-size BYTES]"
+                 << " [--symbols SYM1,SYM2,...] [--side-cap N [--evict drop|archive]]"
+                 << " [--shards N --simulate ORDERS]\n"
+                 << "  Counts may use a K, M or G suffix, e.g. --max-orders 10M --arena-size 1G\n";
+            return 1;
         }
     }
-};
-
-// ================================= Main Function =================================
-
-int main() {
-    MatchingEngine engine;
+    if (instruments.empty()) {
+        instruments.push_back(Instrument::defaultInstrument());
+    }
+    if (simulateCount > 0) {
+        runSimulation(instruments, config, shardCount, simulateCount);
+        return 0;
+    }
+    
+    MatchingEngine engine(instruments, config);
     int choice;
     static int orderCounter = 1;
     
     cout << "=== High-Frequency Trading Engine ===\n";
-    cout << "Welcome to the Order Matching System!\n\n";
+    cout << "Welcome to the Order Matching System!\n";
+    const Arena& arena = engine.getArena();
+    cout << "Memory arena: " << Utils::formatBytes(arena.bytesReserved())
+         << " pre-faulted on " << arena.backingName() << "\n\n";
     
     while (true) {
         cout << "\n========== MAIN MENU ==========\n";
         cout << "1. Place new order\n";
         cout << "2. Show current order book\n";
         cout << "3. Generate random orders\n";
-        cout << "4. Exit\n";
+        cout << "4. Cancel order\n";
+        cout << "5. Modify order\n";
+        cout << "6. Show market depth\n";
+        cout << "7. Show memory stats\n";
+        cout << "8. Advance clock / end of day\n";
+        cout << "9. Exit\n";
         cout << "==============================\n";
-        cout << "Enter your choice (1-4): ";
+        cout << "Enter your choice (1-9): ";
         
         cin >> choice;
         
@@ -363,10 +3459,16 @@ int main() {
         switch (choice) {
             case 1: {
                 string type;
-                double price;
+                string priceText;
                 int quantity;
                 
                 cout << "\n--- Place New Order ---\n";
+                SymbolId symbol = 0;
+                if (!readSymbol(engine, symbol)) {
+                    break;
+                }
+                const Instrument& instrument = engine.getInstrument(symbol);
+                
                 cout << "Enter order type (buy/sell): ";
                 cin >> type;
                 
@@ -375,12 +3477,23 @@ int main() {
                     break;
                 }
                 
-                cout << "Enter price: $";
-                cin >> price;
+                cout << "Enter price, or 'market' to trade at the best available prices: $";
+                cin >> priceText;
                 
-                if (price <= 0) {
-                    cout << "Invalid price! Price must be positive.\n";
-                    break;
+                bool isMarket = priceText == "market";
+                double price = 0;
+                Price priceTicks = NO_PRICE;
+                if (!isMarket) {
+                    try {
+                        price = stod(priceText);
+                    } catch (const exception&) {
+                        price = 0;
+                    }
+                    if (price <= 0 || !instrument.toTicks(price, priceTicks)) {
+                        cout << "Invalid price! Price must be a positive multiple of $"
+                             << instrument.tickSize() << ", or 'market'.\n";
+                        break;
+                    }
                 }
                 
                 cout << "Enter quantity: ";
@@ -391,13 +3504,84 @@ int main() {
                     break;
                 }
                 
-                Order newOrder(orderCounter++, type, price, quantity, Utils::getCurrentTimestamp());
-                engine.processOrder(newOrder);
+                string timeInForce;
+                cout << "Enter time in force (gtc/ioc/fok/day/gtd): ";
+                cin >> timeInForce;
+                
+                if (timeInForce != "gtc" && timeInForce != "ioc" && timeInForce != "fok" &&
+                    timeInForce != "day" && timeInForce != "gtd") {
+                    cout << "Invalid time in force! Please enter 'gtc', 'ioc', 'fok', 'day' or 'gtd'.\n";
+                    break;
+                }
+                
+                // GTD expiries are read as seconds from now on the engine clock
+                EngineTime expiresAt = NO_EXPIRY;
+                if (timeInForce == "gtd") {
+                    double seconds = 0;
+                    cout << "Enter seconds until the order expires: ";
+                    cin >> seconds;
+                    if (seconds <= 0) {
+                        cout << "Invalid expiry! Seconds must be positive.\n";
+                        break;
+                    }
+                    expiresAt = engine.getTime() + static_cast<EngineTime>(llround(seconds * 1000.0));
+                }
+                bool mayRest = timeInForce == "gtc" || timeInForce == "day" || timeInForce == "gtd";
+                
+                // Only a limit order that may rest can be an iceberg
+                int peak = 0;
+                if (!isMarket && mayRest) {
+                    cout << "Enter displayed quantity (0 to show all of it): ";
+                    cin >> peak;
+                    if (peak < 0 || peak > numeric_limits<uint16_t>::max()) {
+                        cout << "Invalid displayed quantity!\n";
+                        break;
+                    }
+                }
+                
+                // A stop price holds the order back until the market trades through it.
+                // Stops carry no expiry, so a GTD order is always entered now.
+                Price stopTicks = NO_PRICE;
+                if (timeInForce != "gtd") {
+                    string stopText;
+                    cout << "Enter stop price, or 0 to enter the order now: $";
+                    cin >> stopText;
+                    double stopPrice = 0;
+                    try {
+                        stopPrice = stod(stopText);
+                    } catch (const exception&) {
+                        stopPrice = -1;
+                    }
+                    if (stopPrice < 0 || (stopPrice > 0 && !instrument.toTicks(stopPrice, stopTicks))) {
+                        cout << "Invalid stop price! Stop price must be 0 or a positive multiple of $"
+                             << instrument.tickSize() << ".\n";
+                        break;
+                    }
+                }
+                
+                Side side = (type == "buy") ? Side::Buy : Side::Sell;
+                Order newOrder = isMarket ? Order::market(orderCounter++, side, quantity, symbol)
+                                          : Order(orderCounter++, side, priceTicks, quantity, 0, symbol);
+                newOrder.timeInForce = timeInForce == "ioc" ? TimeInForce::IOC
+                                     : timeInForce == "fok" ? TimeInForce::FOK
+                                     : timeInForce == "day" ? TimeInForce::DAY
+                                     : timeInForce == "gtd" ? TimeInForce::GTD : TimeInForce::GTC;
+                if (peak > 0 && peak < quantity) {
+                    newOrder.displayQuantity = static_cast<uint16_t>(peak);
+                }
+                if (stopTicks != NO_PRICE) {
+                    engine.submitStopOrder(newOrder, stopTicks);
+                } else {
+                    engine.processOrder(newOrder, expiresAt);
+                }
                 break;
             }
             
             case 2: {
-                engine.displayOrderBook();
+                SymbolId symbol = 0;
+                if (readSymbol(engine, symbol)) {
+                    engine.displayOrderBook(symbol);
+                }
                 break;
             }
             
@@ -416,6 +3600,78 @@ int main() {
             }
             
             case 4: {
+                int orderID;
+                cout << "Enter order ID to cancel: ";
+                cin >> orderID;
+                engine.cancelOrder(orderID);
+                break;
+            }
+            
+            case 5: {
+                int orderID;
+                double price;
+                int quantity;
+                
+                cout << "Enter order ID to modify: ";
+                cin >> orderID;
+                cout << "Enter new price: $";
+                cin >> price;
+                cout << "Enter new quantity: ";
+                cin >> quantity;
+                
+                // Prices are in the ticks of the order's own instrument
+                const Order* resting = engine.findOrder(orderID);
+                const Instrument& instrument = engine.getInstrument(resting != nullptr ? resting->symbol : 0);
+                Price priceTicks = NO_PRICE;
+                if (price <= 0 || !instrument.toTicks(price, priceTicks)) {
+                    cout << "Invalid price! Price must be a positive multiple of $"
+                         << instrument.tickSize() << ".\n";
+                    break;
+                }
+                
+                engine.modifyOrder(orderID, priceTicks, quantity);
+                break;
+            }
+            
+            case 6: {
+                SymbolId symbol = 0;
+                if (readSymbol(engine, symbol)) {
+                    engine.displayDepth(10, symbol); // Top 10 levels per side
+                }
+                break;
+            }
+            
+            case 7: {
+                engine.displayStats();
+                break;
+            }
+            
+            case 8: {
+                string advance;
+                cout << "Clock is at " << fixed << setprecision(3) << engine.getTime() / 1000.0 << defaultfloat
+                     << " s. Enter seconds to advance it, or 'eod' to end the trading day: ";
+                cin >> advance;
+                if (advance == "eod") {
+                    engine.endOfDay();
+                    break;
+                }
+                double seconds = 0;
+                try {
+                    seconds = stod(advance);
+                } catch (const exception&) {
+                    seconds = -1;
+                }
+                if (seconds < 0) {
+                    cout << "Invalid input! Enter a number of seconds or 'eod'.\n";
+                    break;
+                }
+                engine.advanceClock(engine.getTime() + static_cast<EngineTime>(llround(seconds * 1000.0)));
+                cout << "Clock is now at " << fixed << setprecision(3) << engine.getTime() / 1000.0
+                     << defaultfloat << " s\n";
+                break;
+            }
+            
+            case 9: {
                 cout << "\nThank you for using the High-Frequency Trading Engine!\n";
                 cout << "All trades have been logged to 'trades.log'.\n";
                 cout << "Goodbye!\n";
@@ -423,7 +3679,7 @@ int main() {
             }
             
             default: {
-                cout << "Invalid choice! Please enter a number between 1 and 4.\n";
+                cout << "Invalid choice! Please enter a number between 1 and 9.\n";
                 break;
             }
         }